@@ -0,0 +1,169 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "hamming_host.h"
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+
+// Longest AXI4 INCR burst in 32 bit beats
+#define MAX_BURST_BEATS 256
+
+// Counters in front of the per stage almost_full counters
+#define PERF_FIXED_COUNTERS 6
+
+HammingHost::HammingHost(HammingBus& bus, uint64_t baseAddr, uint32_t signatureLength) :
+	m_bus(bus),
+	m_baseAddr(baseAddr),
+	m_sigWords(signatureLength / 32)
+{
+}
+
+bool HammingHost::setThreshold(uint32_t threshold)
+{
+	if (threshold > HAMMING_MAX_THRESHOLD)
+	{
+		std::cout << "The threshold has to be below " << HAMMING_MAX_THRESHOLD + 1 << "." << std::endl;
+		return false;
+	}
+
+	return m_bus.write(m_baseAddr + HAMMING_ADDR_THRESHOLD, &threshold, 1);
+}
+
+bool HammingHost::getThreshold(uint32_t& threshold)
+{
+	if (!m_bus.read(m_baseAddr + HAMMING_ADDR_THRESHOLD, &threshold, 1))
+		return false;
+
+	threshold &= HAMMING_MAX_THRESHOLD;
+	return true;
+}
+
+bool HammingHost::writeSignatureA(const uint32_t* pSig)
+{
+	return m_bus.write(m_baseAddr + HAMMING_ADDR_SIGNATURE_A, pSig, m_sigWords);
+}
+
+bool HammingHost::writeSignatureB(const uint32_t* pSig)
+{
+	return m_bus.write(m_baseAddr + HAMMING_ADDR_SIGNATURE_B, pSig, m_sigWords);
+}
+
+bool HammingHost::readResults(uint64_t* pResults, uint32_t count)
+{
+	std::vector<uint32_t> beats;
+
+	while (count > 0)
+	{
+		const uint32_t words = count < MAX_BURST_BEATS / 4 ? count : MAX_BURST_BEATS / 4;
+		beats.resize(4 * words);
+
+		if (!m_bus.read(m_baseAddr + HAMMING_ADDR_RESULTS, beats.data(), 4 * words))
+			return false;
+
+		// The lowest 32 bits of a 128 bit word come first
+		for (uint32_t i = 0; i < 2 * words; i++)
+			*pResults++ = beats[2 * i] | ((uint64_t)beats[2 * i + 1] << 32);
+
+		count -= words;
+	}
+
+	return true;
+}
+
+bool HammingHost::readCounters(HammingCounters& counters)
+{
+	uint32_t info[2];
+
+	// The counters behind the stage count depend on the generics
+	if (!m_bus.read(m_baseAddr + HAMMING_ADDR_COUNTERS, info, 2))
+		return false;
+
+	const uint32_t count = PERF_FIXED_COUNTERS + info[0];
+	std::vector<uint32_t> words(2 + 2 * count);
+
+	if (!m_bus.read(m_baseAddr + HAMMING_ADDR_COUNTERS, words.data(), (uint32_t)words.size()))
+		return false;
+
+	std::vector<uint64_t> values(count);
+
+	for (uint32_t i = 0; i < count; i++)
+		values[i] = words[2 + 2 * i] | ((uint64_t)words[3 + 2 * i] << 32);
+
+	counters.collectorStages = words[0];
+	counters.elements = words[1];
+	counters.cycles = values[0];
+	counters.busyCycles = values[1];
+	counters.comparisons = values[2];
+	counters.hits = values[3];
+	counters.stallCycles = values[4];
+	counters.streamBeats = values[5];
+	counters.almostFullCycles.assign(values.begin() + PERF_FIXED_COUNTERS, values.end());
+
+	return true;
+}
+
+HammingCounterRates HammingHost::counterRates(const HammingCounters& begin, const HammingCounters& end, double clockMHz)
+{
+	HammingCounterRates rates;
+	const uint64_t cycles = end.cycles - begin.cycles;
+	const double percent = cycles ? 100.0 / cycles : 0.0;
+
+	rates.seconds = cycles / (clockMHz * 1e6);
+	rates.comparisonsPerSec = rates.seconds > 0.0 ? (end.comparisons - begin.comparisons) / rates.seconds : 0.0;
+	rates.hitsPerSec = rates.seconds > 0.0 ? (end.hits - begin.hits) / rates.seconds : 0.0;
+	rates.streamPerSec = rates.seconds > 0.0 ? (end.streamBeats - begin.streamBeats) / rates.seconds : 0.0;
+	rates.busyPercent = (end.busyCycles - begin.busyCycles) * percent;
+	rates.computePercent = (double)(end.comparisons - begin.comparisons) * percent / (end.elements ? end.elements : 1);
+	rates.stallPercent = (end.stallCycles - begin.stallCycles) * percent;
+
+	for (size_t s = 0; s < end.almostFullCycles.size() && s < begin.almostFullCycles.size(); s++)
+		rates.almostFullPercent.push_back((end.almostFullCycles[s] - begin.almostFullCycles[s]) * percent);
+
+	return rates;
+}
+
+void HammingHost::printCounterRates(const HammingCounterRates& rates)
+{
+	printf("---Counters---\n");
+	printf("Interval: %0.6f s\n", rates.seconds);
+	printf("Comparisons: %0.3f M hashes/s, hits: %0.3f M/s\n", rates.comparisonsPerSec / 1e6, rates.hitsPerSec / 1e6);
+	printf("Signatures B from S_AXIS: %0.3f M/s\n", rates.streamPerSec / 1e6);
+	printf("S_AXI busy: %0.2f %%, HPE utilization: %0.2f %%, HPE stalled: %0.2f %%\n", rates.busyPercent, rates.computePercent, rates.stallPercent);
+	printf("Collector almost full:");
+
+	for (size_t s = 0; s < rates.almostFullPercent.size(); s++)
+		printf(" %0.2f %%", rates.almostFullPercent[s]);
+
+	printf("\n");
+
+	// The largest share names what limited the interval
+	if (rates.stallPercent >= rates.busyPercent && rates.stallPercent >= rates.computePercent)
+		printf("Bound by: collector\n");
+	else if (rates.busyPercent >= rates.computePercent)
+		printf("Bound by: host link\n");
+	else
+		printf("Bound by: compute\n");
+}
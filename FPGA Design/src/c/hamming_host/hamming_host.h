@@ -0,0 +1,126 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/* Register map of the S_AXI slave of hamming_dist_top, byte offsets from
+ * the base address of the design. The top level decodes single address
+ * bits, so C_S_AXI_ADDR_WIDTH has to be at least 12.
+ * */
+#define HAMMING_ADDR_SIGNATURE_B 0x040 // Write, SIGNATURE_LENGTH / 32 beats per signature
+#define HAMMING_ADDR_RESULTS     0x100 // Read, 4 beats per 128 bit FIFO word
+#define HAMMING_ADDR_THRESHOLD   0x200 // Read and write, bits 9 to 0
+#define HAMMING_ADDR_COUNTERS    0x400 // Read, snapshot of the performance counters
+#define HAMMING_ADDR_SIGNATURE_A 0x800 // Write, SIGNATURE_LENGTH / 32 beats per signature
+
+#define HAMMING_MAX_THRESHOLD 1023
+
+/* Access to the S_AXI slave, implemented on top of the driver of the
+ * board. Both calls transfer words 32 bit beats as one INCR burst and
+ * return false if the driver failed.
+ * */
+class HammingBus
+{
+public:
+	virtual ~HammingBus() {}
+
+	virtual bool write(uint64_t addr, const uint32_t* pData, uint32_t words) = 0;
+	virtual bool read(uint64_t addr, uint32_t* pData, uint32_t words) = 0;
+};
+
+/* Performance counters of hamming_dist_top, free running since reset */
+struct HammingCounters
+{
+	uint32_t collectorStages;
+	uint32_t elements;
+	uint64_t cycles;
+	uint64_t busyCycles;  // An S_AXI burst in progress
+	uint64_t comparisons; // Valid HPE results
+	uint64_t hits;        // Results forwarded by threshold_checker
+	uint64_t stallCycles; // HPE clock disabled by the HPE FIFOs
+	uint64_t streamBeats; // Signatures B taken from S_AXIS
+	std::vector<uint64_t> almostFullCycles; // Per collector stage, stage 0 are the HPE FIFOs
+};
+
+/* Counters of an interval turned into rates */
+struct HammingCounterRates
+{
+	double seconds;
+	double comparisonsPerSec;
+	double hitsPerSec;
+	double streamPerSec;   // Signatures B per second from S_AXIS
+	double busyPercent;    // S_AXI link, bound by the host when close to 100
+	double computePercent; // Comparisons of the cycles times the elements
+	double stallPercent;   // Back-pressure of the collector onto the HPE
+	std::vector<double> almostFullPercent;
+};
+
+/* Host side of hamming_dist_top. A job is one set of signatures A in the
+ * chain followed by the signatures B compared against it:
+ *   reset of the design (ARESETN, done by the board driver)
+ *   setThreshold, optional, the register keeps its value until the next reset
+ *   writeSignatureA for every element of the chain
+ *   writeSignatureB, or a DMA transfer to S_AXIS, and readResults
+ * The threshold checker takes the register over with every signature A,
+ * so a threshold written during a job applies from the next job on. After
+ * a reset the register holds the THRESHOLD generic.
+ * */
+class HammingHost
+{
+public:
+	HammingHost(HammingBus& bus, uint64_t baseAddr, uint32_t signatureLength);
+
+	/* Results with a distance below threshold are forwarded, at most
+	 * HAMMING_MAX_THRESHOLD
+	 * */
+	bool setThreshold(uint32_t threshold);
+	bool getThreshold(uint32_t& threshold);
+
+	/* Signatures as signatureLength / 32 words, the most significant word
+	 * first like the design shifts them in
+	 * */
+	bool writeSignatureA(const uint32_t* pSig);
+	bool writeSignatureB(const uint32_t* pSig);
+
+	/* Reads count 128 bit FIFO words into pResults, two 64 bit results each.
+	 * The design has no fill level, words read from an empty FIFO repeat
+	 * the last word.
+	 * */
+	bool readResults(uint64_t* pResults, uint32_t count);
+
+	/* Reads a consistent snapshot of all counters */
+	bool readCounters(HammingCounters& counters);
+
+	/* Rates between two snapshots of the same run at the clock of the design */
+	static HammingCounterRates counterRates(const HammingCounters& begin, const HammingCounters& end, double clockMHz);
+	static void printCounterRates(const HammingCounterRates& rates);
+
+private:
+	HammingBus& m_bus;
+	uint64_t m_baseAddr;
+	uint32_t m_sigWords;
+};
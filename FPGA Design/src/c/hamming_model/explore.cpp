@@ -0,0 +1,315 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "hamming_model.h"
+#include "resources.h"
+#include "signatures.h"
+
+struct HitRate
+{
+	double rate;
+	double weight;
+};
+
+struct Candidate
+{
+	ModelConfig cfg;
+	ResourceEstimate res;
+	double clockMHz;
+	double compPerCycle;  // Weighted over the hit rates, while streaming
+	double compPerSec;
+	double lost;          // Share of the comparisons that never happened
+	double mistagged;     // Share of the read results with wrong indices
+	double stalls;        // Share of the clocks with a gated HPE clock
+};
+
+// Comma separated list of numbers
+bool parseList(const char* pArg, std::vector<uint32_t>& vals)
+{
+	vals.clear();
+	const char* p = pArg;
+
+	for (;;)
+	{
+		char* pEnd;
+		const unsigned long v = strtoul(p, &pEnd, 10);
+
+		if (pEnd == p || v > UINT32_MAX || (*pEnd != ',' && *pEnd != '\0'))
+		{
+			std::cout << "Invalid list of numbers: " << pArg << std::endl;
+			return false;
+		}
+
+		vals.push_back((uint32_t)v);
+
+		if (*pEnd == '\0')
+			return true;
+
+		p = pEnd + 1;
+	}
+}
+
+// Comma separated rate:weight pairs, a missing weight is 1
+bool parseHitRates(const char* pArg, std::vector<HitRate>& rates)
+{
+	rates.clear();
+	const char* p = pArg;
+
+	for (;;)
+	{
+		char* pEnd;
+		HitRate hr = { strtod(p, &pEnd), 1.0 };
+		bool ok = pEnd != p;
+
+		if (ok && *pEnd == ':')
+		{
+			p = pEnd + 1;
+			hr.weight = strtod(p, &pEnd);
+			ok = pEnd != p;
+		}
+
+		if (!ok || hr.rate < 0.0 || hr.rate > 1.0 || hr.weight <= 0.0 || (*pEnd != ',' && *pEnd != '\0'))
+		{
+			std::cout << "Invalid hit rates, expected rate[:weight] pairs with rates from 0 to 1: " << pArg << std::endl;
+			return false;
+		}
+
+		rates.push_back(hr);
+
+		if (*pEnd == '\0')
+			return true;
+
+		p = pEnd + 1;
+	}
+}
+
+bool readUInt(const char* pArg, uint32_t& val)
+{
+	std::vector<uint32_t> vals;
+
+	if (!parseList(pArg, vals) || vals.size() != 1)
+	{
+		std::cout << "Invalid number: " << pArg << std::endl;
+		return false;
+	}
+
+	val = vals[0];
+	return true;
+}
+
+/* Runs the cycle model once per hit rate with a single batch of signatures
+ * A and weights the streaming throughput of the runs
+ * */
+void simulate(Candidate& c, const std::vector<HitRate>& rates, uint32_t dynCount, uint32_t seed)
+{
+	double weights = 0.0;
+	double compPerCycle = 0.0;
+	double lost = 0.0;
+	double mistagged = 0.0;
+	double stalls = 0.0;
+
+	for (const HitRate& hr : rates)
+	{
+		Signatures staticData;
+		Signatures dynData;
+		generateSignatures(c.cfg, c.cfg.elements, dynCount, hr.rate, seed, staticData, dynData);
+
+		HammingModel model(c.cfg);
+		std::vector<HwResult> results;
+		ModelStats stats;
+		model.run(staticData, dynData, results, stats);
+
+		weights += hr.weight;
+		compPerCycle += hr.weight * stats.streamComparisons / std::max<uint64_t>(stats.streamCycles, 1);
+		lost += hr.weight * (1.0 - (double)stats.comparisons / std::max<uint64_t>(stats.expectedComparisons, 1));
+		mistagged += hr.weight * stats.mistagged / std::max<uint64_t>(stats.resultsRead, 1);
+		stalls += hr.weight * stats.stallCycles / std::max<uint64_t>(stats.cycles, 1);
+	}
+
+	c.compPerCycle = compPerCycle / weights;
+	c.compPerSec = c.compPerCycle * c.clockMHz * 1e6;
+	c.lost = lost / weights;
+	c.mistagged = mistagged / weights;
+	c.stalls = stalls / weights;
+}
+
+int main(int argc, char* argv[])
+{
+	ModelConfig base;
+	std::vector<uint32_t> elements = { 8, 16, 32, 64, 128 };
+	std::vector<uint32_t> pipelines = { 1, 2, 3, 4 };
+	std::vector<uint32_t> ports = { 2, 4, 8 };
+	std::vector<uint32_t> lengths = { 512 };
+	std::vector<HitRate> rates = { { 0.01, 1.0 } };
+	DeviceBudget budget = DEFAULT_DEVICE_BUDGET;
+	uint32_t dynCount = 400;
+	uint32_t seed = 1;
+	uint32_t top = 20;
+	uint32_t maxClockMHz = 200;
+	const char* pCsvFile = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool ok = true;
+		uint32_t val;
+
+		if (strcmp(argv[i], "--elements") == 0 && i + 1 < argc)
+			ok = parseList(argv[++i], elements);
+		else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc)
+			ok = parseList(argv[++i], pipelines);
+		else if (strcmp(argv[i], "--ports") == 0 && i + 1 < argc)
+			ok = parseList(argv[++i], ports);
+		else if (strcmp(argv[i], "--signature-length") == 0 && i + 1 < argc)
+			ok = parseList(argv[++i], lengths);
+		else if (strcmp(argv[i], "--hit-rates") == 0 && i + 1 < argc)
+			ok = parseHitRates(argv[++i], rates);
+		else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], base.threshold);
+		else if (strcmp(argv[i], "--fifo-depth") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], base.fifoDepth);
+		else if (strcmp(argv[i], "--last-fifo-depth") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], base.lastFifoDepth);
+		else if (strcmp(argv[i], "--fifo-latency") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], base.fifoLatency);
+		else if (strcmp(argv[i], "--txn-cycles") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], base.txnCycles);
+		else if (strcmp(argv[i], "--beat-cycles") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], base.beatCycles);
+		else if (strcmp(argv[i], "--drain-every") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], base.drainEvery);
+		else if (strcmp(argv[i], "--max-clock") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], maxClockMHz);
+		else if (strcmp(argv[i], "--luts") == 0 && i + 1 < argc && (ok = readUInt(argv[++i], val)))
+			budget.luts = val;
+		else if (strcmp(argv[i], "--ffs") == 0 && i + 1 < argc && (ok = readUInt(argv[++i], val)))
+			budget.ffs = val;
+		else if (strcmp(argv[i], "--bram") == 0 && i + 1 < argc && (ok = readUInt(argv[++i], val)))
+			budget.bram36 = val;
+		else if (strcmp(argv[i], "--dynamic-count") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], dynCount);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], seed);
+		else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], top);
+		else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+			pCsvFile = argv[++i];
+		else
+		{
+			printf("Usage: %s [--elements <list>] [--pipeline <list>] [--ports <list>] [--signature-length <list>] [--hit-rates <rate[:weight],...>]\n"
+			       "       [--threshold <dist>] [--fifo-depth <words>] [--last-fifo-depth <words>] [--fifo-latency <clocks>] [--txn-cycles <clocks>]\n"
+			       "       [--beat-cycles <clocks>] [--drain-every <B writes>] [--max-clock <MHz>] [--luts <n>] [--ffs <n>] [--bram <RAMB36>]\n"
+			       "       [--dynamic-count <n>] [--seed <n>] [--top <n>] [--csv <file>]\n", argv[0]);
+			return -1;
+		}
+
+		if (!ok)
+			return -1;
+	}
+
+	std::vector<Candidate> candidates;
+	uint32_t invalid = 0;
+	uint32_t tooLarge = 0;
+
+	for (uint32_t length : lengths)
+		for (uint32_t n : elements)
+			for (uint32_t ps : pipelines)
+				for (uint32_t p : ports)
+				{
+					Candidate c = Candidate();
+					c.cfg = base;
+					c.cfg.signatureLength = length;
+					c.cfg.elements = n;
+					c.cfg.pipelineStages = ps;
+					c.cfg.portsPerArbiter = p;
+
+					if (!HammingModel::validate(c.cfg))
+					{
+						invalid++;
+						continue;
+					}
+
+					c.res = estimateResources(c.cfg);
+
+					if (c.res.luts > budget.luts || c.res.ffs > budget.ffs || c.res.bram36 > budget.bram36)
+					{
+						tooLarge++;
+						continue;
+					}
+
+					c.clockMHz = estimateClockMHz(c.cfg, maxClockMHz);
+					simulate(c, rates, dynCount, seed);
+					candidates.push_back(c);
+				}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.compPerSec > b.compPerSec; });
+
+	printf("Device:      %s (%llu LUT, %llu FF, %.0f RAMB36)\n", budget.pName, (unsigned long long)budget.luts, (unsigned long long)budget.ffs, budget.bram36);
+	printf("Hit rates:  ");
+	for (const HitRate& hr : rates)
+		printf(" %g (weight %g)", hr.rate, hr.weight);
+	printf("\n");
+	printf("Configs:     %zu simulated, %u invalid, %u exceed the device\n\n", candidates.size(), invalid, tooLarge);
+
+	printf("Rank  Elems  Pipe  Ports  SigLen     LUT   LUT%%      FF    FF%%   BRAM  Clock  Cmp/clk    GCmp/s  Lost%%  Mistag%%  Stall%%\n");
+
+	for (size_t i = 0; i < candidates.size() && i < top; i++)
+	{
+		const Candidate& c = candidates[i];
+		printf("%4zu  %5u  %4u  %5u  %6u  %6llu  %5.1f  %6llu  %5.1f  %5.1f  %5.0f  %7.2f  %8.2f  %5.1f  %7.1f  %6.1f\n", i + 1,
+		       c.cfg.elements, c.cfg.pipelineStages, c.cfg.portsPerArbiter, c.cfg.signatureLength,
+		       (unsigned long long)c.res.luts, 100.0 * c.res.luts / budget.luts,
+		       (unsigned long long)c.res.ffs, 100.0 * c.res.ffs / budget.ffs, c.res.bram36,
+		       c.clockMHz, c.compPerCycle, c.compPerSec / 1e9, 100.0 * c.lost, 100.0 * c.mistagged, 100.0 * c.stalls);
+	}
+
+	if (pCsvFile)
+	{
+		std::ofstream ofs(pCsvFile);
+
+		if (!ofs.is_open())
+		{
+			std::cout << "Unable to open " << pCsvFile << std::endl;
+			return -1;
+		}
+
+		ofs << "elements,pipeline_stages,ports_per_arbiter,signature_length,luts,ffs,bram36,clock_mhz,comparisons_per_clock,comparisons_per_second,lost,mistagged,stalls" << std::endl;
+
+		for (const Candidate& c : candidates)
+			ofs << c.cfg.elements << "," << c.cfg.pipelineStages << "," << c.cfg.portsPerArbiter << "," << c.cfg.signatureLength << ","
+			    << c.res.luts << "," << c.res.ffs << "," << c.res.bram36 << "," << c.clockMHz << "," << c.compPerCycle << ","
+			    << c.compPerSec << "," << c.lost << "," << c.mistagged << "," << c.stalls << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,846 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "hamming_model.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Width of the index fields of a result word
+#define IDX_MASK 0x7FFFFFF
+
+// Beats of a 128 bit result word on the 32 bit S_AXI bus
+#define BEATS_PER_READ_WORD 4
+
+// Longest AXI4 INCR burst in 128 bit result words
+#define MAX_READ_WORDS 64
+
+HammingModel::HammingModel(const ModelConfig& cfg) :
+	m_cfg(cfg),
+	m_zero(),
+	m_pTopA(&m_zero),
+	m_pTopB(&m_zero),
+	m_topAPos(-1),
+	m_topBIdx(-1),
+	m_topAValid(false),
+	m_topBValid(false),
+	m_topBStream(false),
+	m_enableD1(true),
+	m_enableD2(true),
+	m_thresholdReg(cfg.threshold),
+	m_pendingA(false),
+	m_pendingB(false),
+	m_pendingRead(false),
+	m_pendingThreshold(false),
+	m_pendingThresholdValue(0),
+	m_pPendingSig(&m_zero),
+	m_pendingShadow(-1),
+	m_threshold(cfg.threshold),
+	m_pStream(nullptr),
+	m_streamPos(0),
+	m_pResults(nullptr),
+	m_aBase(0),
+	m_aCount(0),
+	m_cycle(0),
+	m_phase(PHASE_LOAD),
+	m_pStats(nullptr)
+{
+	const uint32_t n = m_cfg.elements;
+
+	Element elem;
+	elem.pSig1 = &m_zero;
+	elem.sig1Pos = -1;
+	elem.pSig2In = &m_zero;
+	elem.pSig2Out = &m_zero;
+	elem.sig2InIdx = -1;
+	elem.sig2OutIdx = -1;
+	elem.xorCount = 0;
+	elem.xorPair = { -1, -1 };
+	elem.distPipe.assign(m_cfg.pipelineStages, 0);
+	elem.pairPipe.assign(m_cfg.pipelineStages, elem.xorPair);
+	elem.validPipe.assign(m_cfg.pipelineStages + 1, 0);
+	m_elements.assign(n, elem);
+
+	// current_signature_A/B of the wrapper have one entry more than elements
+	m_wrapA.assign(n + 1, &m_zero);
+	m_wrapAPos.assign(n + 1, -1);
+	m_wrapB.assign(n + 1, &m_zero);
+	m_wrapBIdx.assign(n + 1, -1);
+	m_wrapBValid.assign(n + 1, 0);
+	m_nextA = m_wrapA;
+	m_nextAPos = m_wrapAPos;
+	m_nextB = m_wrapB;
+	m_nextBIdx = m_wrapBIdx;
+
+	m_hpeWord.assign(n, 0);
+	m_hpeValid.assign(n, 0);
+	m_hpePair.assign(n, { -1, -1 });
+	m_sig2ValidOut.assign(n, 0);
+
+	m_thrWord.assign(n, 0);
+	m_thrPair.assign(n, elem.xorPair);
+	m_thrValid.assign(n, 0);
+
+	const std::vector<uint32_t> fifos = fifosPerStage(n, m_cfg.portsPerArbiter);
+
+	Fifo fifo;
+	fifo.dout = { 0, { -1, -1 }, 0 };
+	fifo.depth = m_cfg.fifoDepth;
+	fifo.wide = false;
+
+	m_stages.resize(fifos.size());
+	m_arbiters.resize(fifos.size());
+	m_locks.resize(fifos.size());
+	m_flags.resize(fifos.size());
+
+	for (size_t s = 0; s < fifos.size(); s++)
+	{
+		// The last stage aggregates into a single 64 to 128 bit FIFO
+		const bool last = s == fifos.size() - 1;
+		fifo.depth = last ? m_cfg.lastFifoDepth : m_cfg.fifoDepth;
+		fifo.wide = last;
+		m_stages[s].assign(fifos[s], fifo);
+
+		if (s > 0)
+		{
+			m_arbiters[s].assign(fifos[s], { 0, 0, 0 });
+			m_locks[s].assign(fifos[s - 1], 0);
+		}
+
+		m_flags[s].empty.resize(fifos[s]);
+		m_flags[s].almostEmpty.resize(fifos[s]);
+		m_flags[s].full.resize(fifos[s]);
+		m_flags[s].almostFull.resize(fifos[s]);
+	}
+
+	m_readWords[0] = fifo.dout;
+	m_readWords[1] = fifo.dout;
+}
+
+bool HammingModel::validate(const ModelConfig& cfg)
+{
+	if (cfg.signatureLength < 32 || cfg.signatureLength > MAX_SIGNATURE_LENGTH || cfg.signatureLength % 32 != 0)
+	{
+		std::cout << "The signature length has to be a multiple of 32 between 32 and " << MAX_SIGNATURE_LENGTH << "." << std::endl;
+		return false;
+	}
+
+	if (cfg.elements < 2 || cfg.elements > IDX_MASK)
+	{
+		std::cout << "The number of hamming elements has to be between 2 and " << IDX_MASK << "." << std::endl;
+		return false;
+	}
+
+	if (cfg.pipelineStages < 1)
+	{
+		std::cout << "At least one pipeline stage is required." << std::endl;
+		return false;
+	}
+
+	// Range of the generic in hamming_dist_top
+	if (cfg.portsPerArbiter < 2 || cfg.portsPerArbiter > 20)
+	{
+		std::cout << "The ports per arbiter have to be between 2 and 20." << std::endl;
+		return false;
+	}
+
+	// threshold_checker compares against a 10 bit register
+	if (cfg.threshold > 1023 || std::any_of(cfg.batchThresholds.begin(), cfg.batchThresholds.end(), [](uint32_t t) { return t > 1023; }))
+	{
+		std::cout << "The threshold has to be below 1024." << std::endl;
+		return false;
+	}
+
+	if (cfg.fifoDepth < 2 || cfg.lastFifoDepth < 4 || cfg.lastFifoDepth % 2 != 0)
+	{
+		std::cout << "The FIFOs need a depth of at least 2, the last one an even depth of at least 4." << std::endl;
+		return false;
+	}
+
+	if (cfg.stopMargin < 1 || cfg.stopMargin >= cfg.fifoDepth)
+	{
+		std::cout << "The stop margin has to be between 1 and the FIFO depth." << std::endl;
+		return false;
+	}
+
+	if (cfg.txnCycles < 2 || cfg.beatCycles < 1)
+	{
+		std::cout << "A burst takes at least 2 clocks for the response and a beat at least 1 clock." << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+std::vector<uint32_t> HammingModel::fifosPerStage(uint32_t elements, uint32_t portsPerArbiter)
+{
+	// COLLECTOR_STAGES = ceil(log(elements) / log(ports)) + 1, in integers
+	uint32_t stages = 1;
+	for (uint64_t reach = 1; reach < elements; reach *= portsPerArbiter)
+		stages++;
+
+	// CALC_FIFO_PER_STAGE
+	std::vector<uint32_t> fifos(stages);
+	fifos[0] = elements;
+
+	for (uint32_t s = 1; s < stages; s++)
+		fifos[s] = (fifos[s - 1] + portsPerArbiter - 1) / portsPerArbiter;
+
+	return fifos;
+}
+
+uint32_t HammingModel::batchThreshold(const ModelConfig& cfg, uint32_t batch)
+{
+	return cfg.batchThresholds.empty() ? cfg.threshold : cfg.batchThresholds[batch % cfg.batchThresholds.size()];
+}
+
+void HammingModel::run(const Signatures& staticData, const Signatures& dynData, std::vector<HwResult>& results, ModelStats& stats)
+{
+	const uint32_t n = m_cfg.elements;
+
+	stats = ModelStats();
+	stats.stages.resize(m_stages.size());
+
+	for (size_t s = 0; s < m_stages.size(); s++)
+	{
+		stats.stages[s].fifos = (uint32_t)m_stages[s].size();
+		stats.stages[s].depth = m_stages[s][0].depth;
+	}
+
+	m_pStats = &stats;
+	m_pResults = &results;
+
+	for (size_t aBase = 0; aBase < staticData.size(); aBase += n)
+	{
+		m_aBase = (uint32_t)aBase;
+		m_aCount = (uint32_t)std::min<size_t>(n, staticData.size() - aBase);
+		stats.batches++;
+
+		// ARESETN, RESET and back to IDLE
+		m_phase = PHASE_LOAD;
+		reset();
+		clock();
+		clock();
+
+		// The checker takes the register over with the signatures A
+		if (!m_cfg.batchThresholds.empty())
+			busWriteThreshold(batchThreshold(m_cfg, (uint32_t)(stats.batches - 1)));
+
+		// Padding first, the real signatures end up in the elements 0 to aCount-1
+		for (uint32_t pos = 0; pos < n; pos++)
+		{
+			const bool pad = pos < n - m_aCount;
+			busWrite(true, pad ? &m_zero : &staticData[aBase + pos - (n - m_aCount)], (int32_t)pos);
+		}
+
+		m_phase = PHASE_STREAM;
+
+		if (m_cfg.streamB)
+		{
+			// The DMA offers a signature every clock, S_AXI only reads
+			m_pStream = &dynData;
+			m_streamPos = 0;
+
+			while (m_streamPos < dynData.size())
+			{
+				if (!busRead())
+					clock();
+			}
+		}
+		else
+		{
+			for (size_t b = 0; b < dynData.size(); b++)
+			{
+				busWrite(false, &dynData[b], (int32_t)b);
+
+				if (m_cfg.drainEvery != 0 && (b + 1) % m_cfg.drainEvery == 0)
+					while (busRead());
+			}
+		}
+
+		// Read until the chain and the collector ran empty
+		m_phase = PHASE_FLUSH;
+
+		for (;;)
+		{
+			if (busRead())
+				continue;
+
+			if (!busy())
+				break;
+
+			clock();
+		}
+
+		stats.stranded += m_stages.back()[0].entries.size();
+		m_pStream = nullptr;
+	}
+
+	stats.expectedComparisons = stats.batches * n * dynData.size();
+
+	m_pStats = nullptr;
+	m_pResults = nullptr;
+}
+
+bool HammingModel::toInputIndices(const HwResult& result, uint32_t dynCount, uint64_t& word) const
+{
+	const uint64_t dist = result.word & 0x3FF;
+	const uint64_t idxB = (result.word >> 10) & IDX_MASK;
+	const uint64_t idxA = (result.word >> 37) & IDX_MASK;
+
+	if (idxA >= result.aCount || idxB >= dynCount)
+		return false;
+
+	word = dist | (idxB << 10) | ((uint64_t)(result.aBase + result.aCount - 1 - idxA) << 37);
+	return true;
+}
+
+void HammingModel::reset()
+{
+	// FSM RESET state, the HPE reset and srst of the FIFOs. The signature
+	// registers of the HPEs are not reset by the RTL.
+	m_pTopA = &m_zero;
+	m_pTopB = &m_zero;
+	m_topAPos = -1;
+	m_topBIdx = -1;
+	m_topAValid = false;
+	m_topBValid = false;
+	m_topBStream = false;
+	m_thresholdReg = m_cfg.threshold;
+	m_threshold = m_cfg.threshold;
+
+	for (Element& e : m_elements)
+	{
+		std::fill(e.validPipe.begin(), e.validPipe.end(), 0);
+		std::fill(e.distPipe.begin(), e.distPipe.end(), 0);
+		e.xorCount = 0;
+	}
+
+	std::fill(m_wrapBValid.begin(), m_wrapBValid.end(), 0);
+	std::fill(m_thrValid.begin(), m_thrValid.end(), 0);
+
+	for (size_t s = 0; s < m_stages.size(); s++)
+	{
+		for (Fifo& f : m_stages[s])
+			f.entries.clear();
+
+		for (Arbiter& a : m_arbiters[s])
+			a = { 0, 0, 0 };
+
+		std::fill(m_locks[s].begin(), m_locks[s].end(), 0);
+	}
+}
+
+void HammingModel::clock()
+{
+	const uint32_t n = m_cfg.elements;
+	const uint32_t stages = (uint32_t)m_stages.size();
+	const uint32_t ports = m_cfg.portsPerArbiter;
+	const uint32_t portMask = (1u << ports) - 1;
+	const uint32_t pipe = m_cfg.pipelineStages;
+	const bool enable = m_enableD2;
+	ModelStats& stats = *m_pStats;
+
+	// --------- FIFO FLAGS ---------
+	bool enableOut = true;
+
+	for (uint32_t s = 0; s < stages; s++)
+	{
+		StageFlags& flags = m_flags[s];
+		bool almostFull = false;
+
+		for (size_t f = 0; f < m_stages[s].size(); f++)
+		{
+			const Fifo& fifo = m_stages[s][f];
+			flags.empty[f] = empty(fifo);
+			flags.almostEmpty[f] = almostEmpty(fifo);
+			flags.full[f] = fifo.entries.size() >= fifo.depth;
+			flags.almostFull[f] = fifo.entries.size() + 1 >= fifo.depth;
+			almostFull |= flags.almostFull[f] != 0;
+		}
+
+		stats.stages[s].almostFullCycles += almostFull;
+	}
+
+	// ENABLE_HPE_OUT of collector_wrapper from the fill counts of the HPE
+	// FIFOs, only they stop the chain
+	for (uint32_t i = 0; i < n && enableOut; i++)
+		enableOut = m_stages[0][i].entries.size() + m_cfg.stopMargin < m_stages[0][i].depth;
+
+	// --------- COLLECTOR ARBITRATION ---------
+	std::vector<Move>& moves = m_moves;
+	moves.clear();
+
+	for (uint32_t s = 1; s < stages; s++)
+	{
+		const StageFlags& in = m_flags[s - 1];
+		const uint32_t inputs = (uint32_t)m_stages[s - 1].size();
+		std::vector<uint8_t>& nextLocks = m_nextLocks;
+		nextLocks.assign(inputs, 0);
+
+		for (uint32_t j = 0; j < m_stages[s].size(); j++)
+		{
+			Arbiter& arb = m_arbiters[s][j];
+			uint32_t req = 0;
+			uint32_t urgent = 0;
+
+			for (uint32_t p = 0; p < ports && j * ports + p < inputs; p++)
+			{
+				req |= (uint32_t)!in.empty[j * ports + p] << p;
+				urgent |= (uint32_t)in.almostFull[j * ports + p] << p;
+			}
+
+			// arbiterRR is enabled while the FIFO it writes is not full
+			if (m_flags[s].full[j])
+				continue;
+
+			for (uint32_t p = 0; p < ports && j * ports + p < inputs; p++)
+			{
+				const uint32_t src = j * ports + p;
+
+				if (!((arb.grant >> p) & 1))
+					continue;
+
+				// A FIFO that might run empty is skipped for a clock, its
+				// request is one clock old
+				if (m_locks[s][src])
+					continue;
+
+				// The grant is held while the FIFO is full, the granted
+				// input may have run empty in the meantime
+				if (in.empty[src])
+					continue;
+
+				if (in.almostEmpty[src])
+					nextLocks[src] = 1;
+
+				moves.push_back({ s, j, src });
+			}
+
+			// Round robin, the previous winner and all ports below it are
+			// masked, the lowest remaining request wins
+			const uint32_t maskPre = req & ~(((arb.preReq - 1) & portMask) | arb.preReq);
+			const uint32_t win = maskPre != 0 ? maskPre & (~maskPre + 1) : req & (~req + 1);
+			const uint32_t maskPreU = urgent & ~(((arb.preReqUrgent - 1) & portMask) | arb.preReqUrgent);
+			const uint32_t winU = maskPreU != 0 ? maskPreU & (~maskPreU + 1) : urgent & (~urgent + 1);
+
+			if (win != 0)
+				arb.preReq = win;
+
+			if (winU != 0)
+				arb.preReqUrgent = winU;
+
+			arb.grant = urgent != 0 ? winU : win;
+		}
+
+		m_locks[s].swap(nextLocks);
+	}
+
+	// --------- HPE OUTPUTS ---------
+	std::vector<uint64_t>& hpeWord = m_hpeWord;
+	std::vector<uint8_t>& hpeValid = m_hpeValid;
+	std::vector<Pair>& hpePair = m_hpePair;
+	std::vector<uint8_t>& sig2ValidOut = m_sig2ValidOut;
+
+	for (uint32_t i = 0; i < n; i++)
+	{
+		const Element& e = m_elements[i];
+		hpeValid[i] = enable && e.validPipe[pipe];
+		sig2ValidOut[i] = enable && e.validPipe[1];
+		// SIG2_IDX moves with the valid pipe
+		hpePair[i] = e.pairPipe[pipe - 1];
+		hpeWord[i] = (uint64_t)e.distPipe[pipe - 1] | (((uint64_t)hpePair[i].b & IDX_MASK) << 10) | ((uint64_t)i << 37);
+		stats.comparisons += hpeValid[i];
+
+		if (m_phase == PHASE_STREAM)
+			stats.streamComparisons += hpeValid[i];
+	}
+
+	// --------- FIFO WRITES ---------
+	// All writes see the fill levels of the start of the clock, reads are
+	// applied afterwards
+	for (uint32_t i = 0; i < n; i++)
+	{
+		if (m_thrValid[i])
+			push(m_stages[0][i], stats.stages[0], m_thrWord[i], m_thrPair[i]);
+	}
+
+	for (const Move& m : moves)
+	{
+		const Fifo& src = m_stages[m.stage - 1][m.src];
+		const Entry& e = visible(src, 1) != 0 ? src.entries.front() : src.dout;
+		push(m_stages[m.stage][m.dst], stats.stages[m.stage], e.word, e.pair);
+	}
+
+	// --------- FIFO READS ---------
+	for (const Move& m : moves)
+		pop(m_stages[m.stage - 1][m.src], stats.stages[m.stage - 1]);
+
+	if (m_pendingRead)
+	{
+		// The first word written is the upper half of the 128 bit word
+		Fifo& last = m_stages.back()[0];
+		m_readWords[1] = pop(last, stats.stages.back());
+		m_readWords[0] = pop(last, stats.stages.back());
+	}
+
+	// --------- WRAPPER NEXT STATE ---------
+	std::vector<const Signature*>& nextA = m_nextA;
+	std::vector<int32_t>& nextAPos = m_nextAPos;
+
+	nextA[0] = m_elements[0].pSig1;
+	nextAPos[0] = m_elements[0].sig1Pos;
+	nextA[1] = m_wrapA[0];
+	nextAPos[1] = m_wrapAPos[0];
+
+	for (uint32_t i = 2; i <= n; i++)
+	{
+		nextA[i] = m_elements[i - 1].pSig1;
+		nextAPos[i] = m_elements[i - 1].sig1Pos;
+	}
+
+	std::vector<const Signature*>& nextB = m_nextB;
+	std::vector<int32_t>& nextBIdx = m_nextBIdx;
+
+	for (uint32_t i = 0; i < n; i++)
+	{
+		nextB[i + 1] = m_elements[i].pSig2Out;
+		nextBIdx[i + 1] = m_elements[i].sig2OutIdx;
+	}
+
+	// --------- HPE CHAIN (GATED CLOCK) ---------
+	if (enable)
+	{
+		for (uint32_t i = 0; i < n; i++)
+		{
+			Element& e = m_elements[i];
+			const Signature* pSig2 = i == 0 ? m_pTopB : m_wrapB[i];
+			const int32_t sig2Idx = i == 0 ? m_topBIdx : m_wrapBIdx[i];
+			const bool valid2 = i == 0 ? m_topBValid : m_wrapBValid[i] != 0;
+
+			for (uint32_t k = pipe; k > 0; k--)
+				e.validPipe[k] = e.validPipe[k - 1];
+
+			e.validPipe[0] = valid2;
+
+			for (uint32_t k = pipe - 1; k > 0; k--)
+			{
+				e.distPipe[k] = e.distPipe[k - 1];
+				e.pairPipe[k] = e.pairPipe[k - 1];
+			}
+
+			e.distPipe[0] = e.xorCount;
+			e.pairPipe[0] = e.xorPair;
+			// The distance of a clock without valid never leaves the element
+			if (valid2)
+			{
+				e.xorCount = (uint32_t)(*e.pSig1 ^ *pSig2).count();
+				e.xorPair = { e.sig1Pos, sig2Idx };
+			}
+
+			e.pSig2Out = e.pSig2In;
+			e.sig2OutIdx = e.sig2InIdx;
+			e.pSig2In = pSig2;
+			e.sig2InIdx = sig2Idx;
+
+			// SIGNATURE_1_SHIFT is passed through, all elements shift at once
+			if (m_topAValid)
+			{
+				e.pSig1 = i == 0 ? m_pTopA : m_wrapA[i];
+				e.sig1Pos = i == 0 ? m_topAPos : m_wrapAPos[i];
+			}
+		}
+	}
+	else
+	{
+		stats.stallCycles++;
+		stats.lostA += m_topAValid;
+		stats.lostB += m_topBValid && !m_topBStream;
+	}
+
+	// --------- WRAPPER AND THRESHOLD REGISTERS ---------
+	for (uint32_t i = 0; i < n; i++)
+	{
+		// The B registers between the elements hold while the HPE clock is
+		// disabled, like the registers of the elements
+		if (enable)
+			m_wrapBValid[i + 1] = sig2ValidOut[i];
+
+		m_thrWord[i] = hpeWord[i];
+		m_thrPair[i] = hpePair[i];
+		m_thrValid[i] = hpeValid[i] && (hpeWord[i] & 0x3FF) < m_threshold;
+		stats.hits += m_thrValid[i];
+	}
+
+	m_wrapA.swap(nextA);
+	m_wrapAPos.swap(nextAPos);
+
+	if (enable)
+	{
+		m_wrapB.swap(nextB);
+		m_wrapBIdx.swap(nextBIdx);
+	}
+
+	// --------- TOP LEVEL REGISTERS ---------
+	m_enableD2 = m_enableD1;
+	m_enableD1 = enableOut;
+
+	if (m_topAValid)
+		m_threshold = m_thresholdReg;
+
+	if (m_pendingThreshold)
+		m_thresholdReg = m_pendingThresholdValue;
+
+	// S_AXIS takes a beat when the B register is free or the HPE take it
+	// with this clock, a signature of the stream is held while gated
+	const bool streamReady = !m_topBValid || enable;
+	const bool streamHold = m_topBStream && m_topBValid && !enable;
+
+	m_topAValid = m_pendingA;
+	m_topBValid = m_pendingB;
+	m_topBStream = false;
+
+	if (streamHold)
+	{
+		m_topBValid = true;
+		m_topBStream = true;
+		stats.streamWaits += m_pStream && m_streamPos < m_pStream->size();
+	}
+	else if (m_pStream && m_streamPos < m_pStream->size())
+	{
+		if (streamReady)
+		{
+			m_pTopB = &(*m_pStream)[m_streamPos];
+			m_topBIdx = (int32_t)m_streamPos;
+			m_topBValid = true;
+			m_topBStream = true;
+			m_streamPos++;
+			stats.streamBeats++;
+		}
+		else
+			stats.streamWaits++;
+	}
+
+	if (m_pendingA)
+	{
+		m_pTopA = m_pPendingSig;
+		m_topAPos = m_pendingShadow;
+	}
+
+	if (m_pendingB)
+	{
+		m_pTopB = m_pPendingSig;
+		m_topBIdx = m_pendingShadow;
+	}
+
+	m_pendingA = false;
+	m_pendingB = false;
+	m_pendingRead = false;
+	m_pendingThreshold = false;
+
+	// --------- STATISTICS ---------
+	for (uint32_t s = 0; s < stages; s++)
+	{
+		StageStats& st = stats.stages[s];
+
+		for (const Fifo& f : m_stages[s])
+		{
+			st.occupancySum += f.entries.size();
+			st.maxOccupancy = std::max(st.maxOccupancy, (uint32_t)f.entries.size());
+		}
+	}
+
+	stats.cycles++;
+
+	if (m_phase == PHASE_LOAD)
+		stats.loadCycles++;
+	else if (m_phase == PHASE_STREAM)
+		stats.streamCycles++;
+	else
+		stats.flushCycles++;
+
+	m_cycle++;
+}
+
+void HammingModel::busWrite(bool sigA, const Signature* pSig, int32_t shadow)
+{
+	const uint32_t beats = m_cfg.signatureLength / 32;
+
+	m_pStats->writeBursts++;
+
+	// Address phase and the beats, every beat shifts 32 bits into the
+	// signature register, the last one raises the valid for a clock
+	for (uint32_t c = 0; c + 1 < m_cfg.txnCycles - 2 + beats * m_cfg.beatCycles; c++)
+		clock();
+
+	m_pendingA = sigA;
+	m_pendingB = !sigA;
+	m_pPendingSig = pSig;
+	m_pendingShadow = shadow;
+	clock();
+
+	// Write response
+	clock();
+	clock();
+}
+
+void HammingModel::busWriteThreshold(uint32_t threshold)
+{
+	m_pStats->writeBursts++;
+
+	// A single beat, the register takes it with the handshake
+	for (uint32_t c = 0; c + 1 < m_cfg.txnCycles - 2 + m_cfg.beatCycles; c++)
+		clock();
+
+	m_pendingThreshold = true;
+	m_pendingThresholdValue = threshold;
+	clock();
+
+	clock();
+	clock();
+}
+
+bool HammingModel::busRead()
+{
+	Fifo& last = m_stages.back()[0];
+	const uint32_t words = std::min<uint32_t>(visible(last, 2 * MAX_READ_WORDS) / 2, MAX_READ_WORDS);
+
+	// There is no fill level register, the model reads what is there
+	if (words == 0)
+		return false;
+
+	m_pStats->readBursts++;
+
+	for (uint32_t c = 0; c < m_cfg.txnCycles; c++)
+		clock();
+
+	for (uint32_t w = 0; w < words; w++)
+	{
+		// READ_FIFO_OUTPUT, then BYPASS_0 to 3 put out 32 bits each, lowest first
+		m_pendingRead = true;
+		clock();
+
+		for (uint32_t c = 0; c < BEATS_PER_READ_WORD * m_cfg.beatCycles; c++)
+			clock();
+
+		readWord(m_readWords[0]);
+		readWord(m_readWords[1]);
+	}
+
+	return true;
+}
+
+void HammingModel::readWord(const Entry& entry)
+{
+	const uint32_t idxB = (uint32_t)(entry.word >> 10) & IDX_MASK;
+	const uint32_t idxA = (uint32_t)(entry.word >> 37) & IDX_MASK;
+
+	if (entry.pair.a != (int32_t)(m_cfg.elements - 1 - idxA) || entry.pair.b != (int32_t)idxB)
+		m_pStats->mistagged++;
+
+	m_pResults->push_back({ entry.word, m_aBase, m_aCount });
+	m_pStats->resultsRead++;
+}
+
+bool HammingModel::busy() const
+{
+	if (m_topAValid || m_topBValid)
+		return true;
+
+	for (uint32_t i = 0; i < m_cfg.elements; i++)
+	{
+		const Element& e = m_elements[i];
+
+		if (std::find(e.validPipe.begin(), e.validPipe.end(), 1) != e.validPipe.end())
+			return true;
+
+		if (m_wrapBValid[i + 1] || m_thrValid[i])
+			return true;
+	}
+
+	for (size_t s = 0; s + 1 < m_stages.size(); s++)
+	{
+		for (const Fifo& f : m_stages[s])
+		{
+			if (!f.entries.empty())
+				return true;
+		}
+	}
+
+	// Words of the last FIFO that are not at its output yet
+	const Fifo& last = m_stages.back()[0];
+	return visible(last, (uint32_t)last.entries.size()) != last.entries.size();
+}
+
+uint32_t HammingModel::visible(const Fifo& fifo, uint32_t limit) const
+{
+	uint32_t cnt = 0;
+
+	for (const Entry& e : fifo.entries)
+	{
+		if (cnt == limit || e.ready > m_cycle)
+			break;
+
+		cnt++;
+	}
+
+	return cnt;
+}
+
+bool HammingModel::empty(const Fifo& fifo) const
+{
+	// The 128 bit side needs two words
+	return visible(fifo, 2) < (fifo.wide ? 2u : 1u);
+}
+
+bool HammingModel::almostEmpty(const Fifo& fifo) const
+{
+	return visible(fifo, 4) < (fifo.wide ? 4u : 2u);
+}
+
+void HammingModel::push(Fifo& fifo, StageStats& stats, uint64_t word, const Pair& pair)
+{
+	stats.writes++;
+
+	if (fifo.entries.size() >= fifo.depth)
+	{
+		stats.overflows++;
+		return;
+	}
+
+	fifo.entries.push_back({ word, pair, m_cycle + std::max<uint32_t>(m_cfg.fifoLatency, 1) });
+}
+
+HammingModel::Entry HammingModel::pop(Fifo& fifo, StageStats& stats)
+{
+	if (visible(fifo, 1) == 0)
+	{
+		stats.underflows++;
+		return fifo.dout;
+	}
+
+	fifo.dout = fifo.entries.front();
+	fifo.entries.pop_front();
+	return fifo.dout;
+}
@@ -0,0 +1,312 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <bitset>
+#include <deque>
+#include <vector>
+
+// Widest SIGNATURE_LENGTH the model takes, the size of the hashes of the software engines
+#define MAX_SIGNATURE_LENGTH 512
+
+typedef std::bitset<MAX_SIGNATURE_LENGTH> Signature;
+typedef std::vector<Signature> Signatures;
+
+/* Generics of hamming_dist_top plus the parts the RTL takes from IP cores
+ * and from the bus master. The defaults are the FIFO cores instantiated in
+ * collector.vhd and a master that raises BREADY with the write response.
+ * */
+struct ModelConfig
+{
+	uint32_t signatureLength = 512; // SIGNATURE_LENGTH, a multiple of 32
+	uint32_t elements        = 16;  // NUMBER_OF_HAMMING_ELEMENTS
+	uint32_t pipelineStages  = 2;   // PIPELINE_STAGES
+	uint32_t portsPerArbiter = 4;   // PORTS_PER_ARBITER
+	uint32_t threshold       = 200; // THRESHOLD, the threshold register after reset
+
+	// Written to the threshold register before the signatures A of a batch,
+	// batch i uses entry i modulo the size. Empty keeps THRESHOLD.
+	std::vector<uint32_t> batchThresholds;
+
+	uint32_t fifoDepth     = 32; // fifo_cmnclkbram_fwft_wwr64_d32_wrd64
+	uint32_t lastFifoDepth = 64; // fifo_cmnclkbram_fwft_wwr64_d64_wrd128, in 64 bit words
+	uint32_t fifoLatency   = 2;  // Clocks from wr_en until the word is at the FWFT output
+
+	uint32_t txnCycles  = 4; // Address handshake, state change and response of one S_AXI burst, the last 2 are the response
+	uint32_t beatCycles = 1; // Clocks per 32 bit data beat
+	uint32_t drainEvery = 0; // Read the results after every n signature B writes, 0 only at the end of a batch
+
+	bool streamB        = false; // Signatures B over S_AXIS, offered every clock, results are read whenever there are some
+	uint32_t stopMargin = 8;     // PEFIFO_STOP_MARGIN, collector_wrapper stops the HPE this many words before full
+};
+
+/* Occupancy and flow of the FIFOs of one collector stage, stage 0 are the
+ * HPE FIFOs of collector_wrapper
+ * */
+struct StageStats
+{
+	uint32_t fifos;
+	uint32_t depth;
+	uint64_t occupancySum;  // Words summed over all FIFOs and clocks
+	uint32_t maxOccupancy;  // Fullest single FIFO
+	uint64_t writes;
+	uint64_t overflows;     // wr_en while full, the word is lost
+	uint64_t underflows;    // Granted reads of an empty FIFO, the stale output is written on
+	uint64_t almostFullCycles; // Clocks with almost_full of any FIFO, like the counter of the RTL
+};
+
+struct ModelStats
+{
+	uint64_t cycles;
+	uint64_t loadCycles;    // Reset and signature A writes
+	uint64_t streamCycles;  // Signature B writes and the reads in between
+	uint64_t flushCycles;   // Waiting for the chain and the collector and the final reads
+	uint64_t stallCycles;   // HPE clock gated by the collector
+	uint64_t comparisons;   // Valid HPE outputs
+	uint64_t streamComparisons;
+	uint64_t hits;          // Results forwarded by threshold_checker
+	uint64_t resultsRead;
+	uint64_t stranded;      // Odd result left in the 128 bit FIFO at the end of a batch
+	uint64_t lostA;         // Signature A valid while the HPE clock was gated
+	uint64_t lostB;         // Signature B valid while the HPE clock was gated, S_AXI writes only
+	uint64_t streamBeats;   // Signatures B taken from S_AXIS
+	uint64_t streamWaits;   // Clocks with a signature B offered on S_AXIS and TREADY low
+	uint64_t mistagged;     // Read results whose indices are not the pair that was compared
+	uint64_t expectedComparisons;
+	uint64_t batches;
+	uint64_t writeBursts;
+	uint64_t readBursts;
+	std::vector<StageStats> stages;
+};
+
+/* A result word as read from S_AXI plus what is needed to translate its
+ * indices into indices of the input sets
+ * */
+struct HwResult
+{
+	uint64_t word;
+	uint32_t aBase;  // First signature A of the batch
+	uint32_t aCount; // Signatures A of the batch, the rest of the chain is padding
+};
+
+/* Cycle level model of hamming_dist_top: the software write FSM, the HPE
+ * chain of hamming_dist_element_wrapper with its gated clock, the
+ * threshold_checker, the collector_elem FIFO tree with its arbiterRR
+ * instances and the 128 bit result readout. Every register of the RTL
+ * that influences timing or result words is modelled, signatures are only
+ * referenced.
+ * The result words are bit exact, including what the RTL does with them:
+ * idxA is the position in the chain, so the last signature A written is 0.
+ * idxB travels with signature B through the chain. Odd results stay in
+ * the 64 to 128 bit FIFO, valids of S_AXI writes that arrive while the HPE
+ * clock is gated are lost, S_AXIS holds them. The model counts all of
+ * these.
+ * The FIFO cores are modelled from their data sheet behaviour: flags are
+ * registered, almost_full is one word before full, almost_empty one word
+ * before empty and the first 64 bit word written is the upper half of a
+ * 128 bit word.
+ * */
+class HammingModel
+{
+public:
+	explicit HammingModel(const ModelConfig& cfg);
+
+	/* Checks the generics like elaboration of the RTL would, prints the
+	 * reason and returns false if they are not supported
+	 * */
+	static bool validate(const ModelConfig& cfg);
+
+	/* Threshold the checker applies to the results of a batch */
+	static uint32_t batchThreshold(const ModelConfig& cfg, uint32_t batch);
+
+	/* COLLECTOR_STAGES and the FIFOs per stage as computed in hamming_dist_top */
+	static std::vector<uint32_t> fifosPerStage(uint32_t elements, uint32_t portsPerArbiter);
+
+	/* Compares every signature of dynData against staticData. The chain
+	 * holds one batch of elements signatures A, every batch starts with a
+	 * reset, is filled and then streams all of dynData. A short last batch
+	 * is padded with zero signatures. Results are appended in read order.
+	 * */
+	void run(const Signatures& staticData, const Signatures& dynData, std::vector<HwResult>& results, ModelStats& stats);
+
+	/* Translates the indices of a result into indices of the input sets,
+	 * the layout written by the software engines. Returns false for
+	 * results of padding elements or with a B index outside of dynCount.
+	 * */
+	bool toInputIndices(const HwResult& result, uint32_t dynCount, uint64_t& word) const;
+
+private:
+	// True pair of a value in flight, used to find mistagged results
+	struct Pair
+	{
+		int32_t a; // Write position of signature A in the batch
+		int32_t b; // Index of signature B
+	};
+
+	struct Element
+	{
+		const Signature* pSig1;    // current_signature_1_in
+		int32_t sig1Pos;
+		const Signature* pSig2In;  // current_signature_2_in
+		const Signature* pSig2Out; // SIGNATURE_2_OUT
+		int32_t sig2InIdx;
+		int32_t sig2OutIdx;
+		uint32_t xorCount;         // c_xor_result, kept as its popcount
+		Pair xorPair;
+		std::vector<uint32_t> distPipe;
+		std::vector<Pair> pairPipe;
+		std::vector<uint8_t> validPipe; // PIPELINE_STAGES + 1 entries
+	};
+
+	struct Entry
+	{
+		uint64_t word;
+		Pair pair;
+		uint64_t ready; // Clock at which the word reaches the FWFT output
+	};
+
+	struct Fifo
+	{
+		std::deque<Entry> entries;
+		Entry dout; // Output register, keeps the last word when empty
+		uint32_t depth;
+		bool wide;  // 64 bit write, 128 bit read
+	};
+
+	struct Arbiter
+	{
+		uint32_t preReq;
+		uint32_t preReqUrgent;
+		uint32_t grant;
+	};
+
+	struct StageFlags
+	{
+		std::vector<uint8_t> empty;
+		std::vector<uint8_t> almostEmpty;
+		std::vector<uint8_t> full;
+		std::vector<uint8_t> almostFull;
+	};
+
+	// Read of a FIFO granted by an arbiter, written to the next stage
+	struct Move
+	{
+		uint32_t stage; // Stage of the written FIFO
+		uint32_t dst;
+		uint32_t src;   // FIFO of the previous stage
+	};
+
+	enum Phase
+	{
+		PHASE_LOAD,
+		PHASE_STREAM,
+		PHASE_FLUSH
+	};
+
+	void reset();
+	void clock();
+	void busWrite(bool sigA, const Signature* pSig, int32_t shadow);
+	void busWriteThreshold(uint32_t threshold);
+	void readWord(const Entry& entry);
+	bool busRead();
+	bool busy() const;
+
+	uint32_t visible(const Fifo& fifo, uint32_t limit) const;
+	bool empty(const Fifo& fifo) const;
+	bool almostEmpty(const Fifo& fifo) const;
+	void push(Fifo& fifo, StageStats& stats, uint64_t word, const Pair& pair);
+	Entry pop(Fifo& fifo, StageStats& stats);
+
+	ModelConfig m_cfg;
+	Signature m_zero;
+
+	// Top level registers
+	const Signature* m_pTopA;
+	const Signature* m_pTopB;
+	int32_t m_topAPos;
+	int32_t m_topBIdx;
+	bool m_topAValid;
+	bool m_topBValid;
+	bool m_topBStream; // current_sig_B_stream
+	bool m_enableD1;
+	bool m_enableD2;
+	uint32_t m_thresholdReg; // current_threshold
+
+	// Effects of the bus at the end of the current clock
+	bool m_pendingA;
+	bool m_pendingB;
+	bool m_pendingRead;
+	bool m_pendingThreshold;
+	uint32_t m_pendingThresholdValue;
+	const Signature* m_pPendingSig;
+	int32_t m_pendingShadow;
+
+	// hamming_dist_element_wrapper
+	std::vector<Element> m_elements;
+	std::vector<const Signature*> m_wrapA;
+	std::vector<int32_t> m_wrapAPos;
+	std::vector<const Signature*> m_wrapB;
+	std::vector<int32_t> m_wrapBIdx;
+	std::vector<uint8_t> m_wrapBValid;
+
+	// threshold_checker
+	uint32_t m_threshold; // Latched with the signatures A of a batch
+	std::vector<uint64_t> m_thrWord;
+	std::vector<Pair> m_thrPair;
+	std::vector<uint8_t> m_thrValid;
+
+	// collector_wrapper and collector_elem, stage 0 are the HPE FIFOs
+	std::vector<std::vector<Fifo>> m_stages;
+	std::vector<std::vector<Arbiter>> m_arbiters; // Per stage, empty for stage 0
+	std::vector<std::vector<uint8_t>> m_locks;    // current_fifo_lock_rd per input of a stage
+
+	// Combinational signals of a clock, kept to not allocate them every clock
+	std::vector<StageFlags> m_flags;
+	std::vector<Move> m_moves;
+	std::vector<uint8_t> m_nextLocks;
+	std::vector<uint64_t> m_hpeWord;
+	std::vector<uint8_t> m_hpeValid;
+	std::vector<Pair> m_hpePair;
+	std::vector<uint8_t> m_sig2ValidOut;
+	std::vector<const Signature*> m_nextA;
+	std::vector<int32_t> m_nextAPos;
+	std::vector<const Signature*> m_nextB;
+	std::vector<int32_t> m_nextBIdx;
+
+	// S_AXIS source, set while a batch streams its signatures B
+	const Signatures* m_pStream;
+	size_t m_streamPos;
+
+	// Read back
+	Entry m_readWords[2];
+	std::vector<HwResult>* m_pResults;
+	uint32_t m_aBase;
+	uint32_t m_aCount;
+
+	uint64_t m_cycle;
+	Phase m_phase;
+	ModelStats* m_pStats;
+};
@@ -0,0 +1,312 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include "hamming_model.h"
+#include "signatures.h"
+
+bool readUInt(const char* pArg, uint32_t& val)
+{
+	char* pEnd;
+	const unsigned long v = strtoul(pArg, &pEnd, 10);
+
+	if (*pArg == '\0' || *pEnd != '\0' || v > UINT32_MAX)
+	{
+		std::cout << "Invalid number: " << pArg << std::endl;
+		return false;
+	}
+
+	val = (uint32_t)v;
+	return true;
+}
+
+// Comma separated list of numbers
+bool readUIntList(const char* pArg, std::vector<uint32_t>& vals)
+{
+	std::string arg(pArg);
+	size_t pos = 0;
+
+	vals.clear();
+
+	for (;;)
+	{
+		const size_t end = arg.find(',', pos);
+		uint32_t val;
+
+		if (!readUInt(arg.substr(pos, end - pos).c_str(), val))
+			return false;
+
+		vals.push_back(val);
+
+		if (end == std::string::npos)
+			return true;
+
+		pos = end + 1;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	ModelConfig cfg;
+	const char* pStaticFile = nullptr;
+	const char* pDynFile = nullptr;
+	const char* pOutputFile = nullptr;
+	bool inputIndices = false;
+	uint32_t staticCount = 64;
+	uint32_t dynCount = 1000;
+	uint32_t seed = 1;
+	uint32_t clockMHz = 200;
+	double hitRate = 0.01;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool ok = true;
+
+		if (strcmp(argv[i], "--elements") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.elements);
+		else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.pipelineStages);
+		else if (strcmp(argv[i], "--ports") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.portsPerArbiter);
+		else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.threshold);
+		else if (strcmp(argv[i], "--batch-thresholds") == 0 && i + 1 < argc)
+			ok = readUIntList(argv[++i], cfg.batchThresholds);
+		else if (strcmp(argv[i], "--signature-length") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.signatureLength);
+		else if (strcmp(argv[i], "--fifo-depth") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.fifoDepth);
+		else if (strcmp(argv[i], "--last-fifo-depth") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.lastFifoDepth);
+		else if (strcmp(argv[i], "--fifo-latency") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.fifoLatency);
+		else if (strcmp(argv[i], "--txn-cycles") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.txnCycles);
+		else if (strcmp(argv[i], "--beat-cycles") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.beatCycles);
+		else if (strcmp(argv[i], "--stream") == 0)
+			cfg.streamB = true;
+		else if (strcmp(argv[i], "--stop-margin") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.stopMargin);
+		else if (strcmp(argv[i], "--drain-every") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], cfg.drainEvery);
+		else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], clockMHz);
+		else if (strcmp(argv[i], "--static") == 0 && i + 1 < argc)
+			pStaticFile = argv[++i];
+		else if (strcmp(argv[i], "--dynamic") == 0 && i + 1 < argc)
+			pDynFile = argv[++i];
+		else if (strcmp(argv[i], "--static-count") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], staticCount);
+		else if (strcmp(argv[i], "--dynamic-count") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], dynCount);
+		else if (strcmp(argv[i], "--hit-rate") == 0 && i + 1 < argc)
+			hitRate = atof(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			ok = readUInt(argv[++i], seed);
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			pOutputFile = argv[++i];
+		else if (strcmp(argv[i], "--input-indices") == 0)
+			inputIndices = true;
+		else
+		{
+			printf("Usage: %s [--elements <n>] [--pipeline <stages>] [--ports <per arbiter>] [--threshold <dist>] [--batch-thresholds <list>]\n"
+			       "       [--signature-length <bits>] [--fifo-depth <words>] [--last-fifo-depth <words>] [--fifo-latency <clocks>] [--txn-cycles <clocks>] [--beat-cycles <clocks>]\n"
+			       "       [--stream] [--stop-margin <words>] [--drain-every <B writes>] [--clock <MHz>] [--static <file>] [--dynamic <file>] [--static-count <n>] [--dynamic-count <n>]\n"
+			       "       [--hit-rate <0..1>] [--seed <n>] [--output <file> [--input-indices]]\n", argv[0]);
+			return -1;
+		}
+
+		if (!ok)
+			return -1;
+	}
+
+	if (!HammingModel::validate(cfg))
+		return -1;
+
+	if (hitRate < 0.0 || hitRate > 1.0)
+	{
+		std::cout << "The hit rate has to be between 0 and 1." << std::endl;
+		return -1;
+	}
+
+	// --------- INPUT DATA ---------
+	Signatures staticData;
+	Signatures dynData;
+
+	if ((pStaticFile == nullptr) != (pDynFile == nullptr))
+	{
+		std::cout << "--static and --dynamic have to be given together." << std::endl;
+		return -1;
+	}
+
+	if (pStaticFile)
+	{
+		if (!readSignatures(pStaticFile, cfg.signatureLength, staticData) || !readSignatures(pDynFile, cfg.signatureLength, dynData))
+			return -1;
+	}
+	else
+		generateSignatures(cfg, staticCount, dynCount, hitRate, seed, staticData, dynData);
+
+	if (dynData.size() > 0x7FFFFFF)
+	{
+		std::cout << "Too many signatures B, the indices do not fit into the 27 bit fields of a result." << std::endl;
+		return -1;
+	}
+
+	const std::vector<uint32_t> fifos = HammingModel::fifosPerStage(cfg.elements, cfg.portsPerArbiter);
+
+	printf("---Model---\n");
+	printf("Signature length: %u, elements: %u, pipeline stages: %u, ports per arbiter: %u, threshold: %u\n",
+	       cfg.signatureLength, cfg.elements, cfg.pipelineStages, cfg.portsPerArbiter, cfg.threshold);
+	if (!cfg.batchThresholds.empty())
+	{
+		printf("Batch thresholds:");
+		for (uint32_t t : cfg.batchThresholds)
+			printf(" %u", t);
+		printf("\n");
+	}
+	printf("Collector stages: %u (FIFOs:", (uint32_t)fifos.size());
+	for (uint32_t f : fifos)
+		printf(" %u", f);
+	printf(")\n");
+	printf("Signatures A: %llu, B: %llu\n", (unsigned long long)staticData.size(), (unsigned long long)dynData.size());
+
+	// --------- RUN ---------
+	HammingModel model(cfg);
+	std::vector<HwResult> results;
+	ModelStats stats;
+
+	model.run(staticData, dynData, results, stats);
+
+	// --------- REPORT ---------
+	const double cycles = (double)std::max<uint64_t>(stats.cycles, 1);
+	const double streamCycles = (double)std::max<uint64_t>(stats.streamCycles, 1);
+
+	printf("---Cycles---\n");
+	printf("Total: %llu (load: %llu, stream: %llu, flush: %llu), batches: %llu\n", (unsigned long long)stats.cycles,
+	       (unsigned long long)stats.loadCycles, (unsigned long long)stats.streamCycles, (unsigned long long)stats.flushCycles, (unsigned long long)stats.batches);
+	printf("Stall cycles (HPE clock gated): %llu (%0.2f %%)\n", (unsigned long long)stats.stallCycles, 100.0 * stats.stallCycles / cycles);
+	printf("Bursts written: %llu, read: %llu\n", (unsigned long long)stats.writeBursts, (unsigned long long)stats.readBursts);
+
+	printf("---Throughput---\n");
+	printf("Comparisons: %llu of %llu\n", (unsigned long long)stats.comparisons, (unsigned long long)stats.expectedComparisons);
+	printf("Comparisons per cycle: %0.3f overall, %0.3f while streaming\n", stats.comparisons / cycles, stats.streamComparisons / streamCycles);
+	printf("At %u MHz: %0.3f M comparisons/s\n", clockMHz, stats.comparisons / cycles * clockMHz);
+
+	printf("---Collector---\n");
+	printf("Stage  FIFOs  Depth  Mean fill  Max fill  Almost full     Writes  Overflows  Underflows\n");
+
+	for (size_t s = 0; s < stats.stages.size(); s++)
+	{
+		const StageStats& st = stats.stages[s];
+		printf("%5u  %5u  %5u  %9.2f  %8u  %9.2f %%  %9llu  %9llu  %10llu\n", (uint32_t)s, st.fifos, st.depth, st.occupancySum / (cycles * st.fifos),
+		       st.maxOccupancy, 100.0 * st.almostFullCycles / cycles, (unsigned long long)st.writes, (unsigned long long)st.overflows, (unsigned long long)st.underflows);
+	}
+
+	printf("---Results---\n");
+	printf("Hits: %llu, read: %llu, stranded: %llu, mistagged: %llu\n", (unsigned long long)stats.hits, (unsigned long long)stats.resultsRead,
+	       (unsigned long long)stats.stranded, (unsigned long long)stats.mistagged);
+	printf("Valids lost while gated, A: %llu, B: %llu\n", (unsigned long long)stats.lostA, (unsigned long long)stats.lostB);
+
+	if (cfg.streamB)
+	{
+		printf("---Stream---\n");
+		printf("Signatures B taken: %llu, clocks waiting for TREADY: %llu\n", (unsigned long long)stats.streamBeats, (unsigned long long)stats.streamWaits);
+		printf("Signatures B per clock while streaming: %0.3f\n", stats.streamBeats / streamCycles);
+	}
+
+	// Translated into indices of the input sets and sorted like the software engines
+	std::vector<uint64_t> translated;
+
+	for (const HwResult& r : results)
+	{
+		uint64_t word;
+
+		if (model.toInputIndices(r, (uint32_t)dynData.size(), word))
+			translated.push_back(word);
+	}
+
+	auto resultLess = [](uint64_t l, uint64_t r)
+	{
+		const uint64_t keyL = (((l >> 10) & 0x7FFFFFF) << 27) | ((l >> 37) & 0x7FFFFFF);
+		const uint64_t keyR = (((r >> 10) & 0x7FFFFFF) << 27) | ((r >> 37) & 0x7FFFFFF);
+		return keyL != keyR ? keyL < keyR : l < r;
+	};
+
+	std::sort(translated.begin(), translated.end(), resultLess);
+
+	// --------- VERIFY ---------
+	std::vector<uint64_t> expected;
+
+	for (size_t b = 0; b < dynData.size(); b++)
+	{
+		for (size_t a = 0; a < staticData.size(); a++)
+		{
+			const uint64_t dist = (staticData[a] ^ dynData[b]).count();
+
+			if (dist < HammingModel::batchThreshold(cfg, (uint32_t)(a / cfg.elements)))
+				expected.push_back(dist | ((uint64_t)b << 10) | ((uint64_t)a << 37));
+		}
+	}
+
+	std::vector<uint64_t> missing;
+	std::vector<uint64_t> unexpected;
+	std::set_difference(expected.begin(), expected.end(), translated.begin(), translated.end(), std::back_inserter(missing), resultLess);
+	std::set_difference(translated.begin(), translated.end(), expected.begin(), expected.end(), std::back_inserter(unexpected), resultLess);
+
+	std::cout << std::endl << "Expected: " << std::dec << expected.size() << std::endl << "Missing: " << missing.size() << std::endl
+	          << "Unexpected: " << unexpected.size() << std::endl;
+
+	if (pOutputFile)
+	{
+		// Raw 64 bit Result words in read order, or translated like the --output of the software engines
+		std::ofstream outfile(pOutputFile, std::ios::binary);
+
+		if (!outfile.is_open())
+		{
+			std::cout << "Error while opening the output file " << pOutputFile << std::endl;
+			return -1;
+		}
+
+		if (inputIndices)
+			outfile.write((const char*)translated.data(), translated.size() * sizeof(uint64_t));
+		else
+		{
+			for (const HwResult& r : results)
+				outfile.write((const char*)&r.word, sizeof(uint64_t));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "resources.h"
+
+#include <algorithm>
+#include <cmath>
+
+// fifo_cmnclkbram_fwft_* control logic: pointers, flags and the FWFT output stage
+#define FIFO_CTRL_LUTS 60
+#define FIFO_CTRL_FFS  90
+
+// AXI4 slave, software FSM, result store and indices of hamming_dist_top
+#define TOP_LUTS 550
+#define TOP_FFS  450
+
+// Virtex-7 -2: one LUT6 level with its net, clock to out plus setup and skew
+#define NS_PER_LOGIC_LEVEL 0.9
+#define NS_PER_STAGE_OVERHEAD 1.2
+
+static uint32_t distBits(uint32_t signatureLength)
+{
+	// HAMMING_DIST_LENGTH + 1, the distance itself can reach SIGNATURE_LENGTH
+	uint32_t bits = 0;
+	while ((1u << bits) < signatureLength)
+		bits++;
+
+	return bits + 1;
+}
+
+ResourceEstimate estimateResources(const ModelConfig& cfg)
+{
+	const uint64_t len = cfg.signatureLength;
+	const uint64_t n = cfg.elements;
+	const uint64_t ports = cfg.portsPerArbiter;
+	const uint32_t dist = distBits(cfg.signatureLength);
+	ResourceEstimate res = { TOP_LUTS, TOP_FFS, 0.0 };
+
+	// --------- HPE ---------
+	// hamming_dist_elem: signature 1, signature 2 in and out, xor, the
+	// distance and valid pipes. Wrapper: signature A and B with the B valid.
+	// threshold_checker: distance, idxB and valid, idxA is a constant.
+	const uint64_t elemFFs = 6 * len + cfg.pipelineStages * dist + cfg.pipelineStages + 1 + 1 + 10 + 27 + 1;
+
+	// Two xor bits per LUT6_2, three LUTs per lookup6 and the adder tree
+	// that sums the 3 bit counts of the 6 bit groups
+	const uint64_t groups = (len + 5) / 6;
+	uint64_t treeLuts = 0;
+	uint64_t width = 3;
+
+	for (uint64_t terms = groups; terms > 1; terms = (terms + 1) / 2)
+	{
+		treeLuts += (terms / 2) * width;
+		width++;
+	}
+
+	// Valid muxes of GLOBAL_ENABLE and the threshold compare
+	const uint64_t elemLuts = len / 2 + 3 * groups + treeLuts + 2 + 3;
+
+	res.ffs += n * elemFFs;
+	res.luts += n * elemLuts;
+
+	// Signature A and B shift registers of the top level
+	res.ffs += 2 * len;
+
+	// --------- COLLECTOR ---------
+	const std::vector<uint32_t> fifos = HammingModel::fifosPerStage(cfg.elements, cfg.portsPerArbiter);
+
+	for (size_t s = 0; s < fifos.size(); s++)
+	{
+		const bool last = s == fifos.size() - 1;
+
+		// 64 bit words fit a RAMB36 in simple dual port mode, the 128 bit
+		// read port of the last FIFO needs two
+		res.bram36 += fifos[s] * (last ? 2.0 : 1.0);
+		res.luts += fifos[s] * FIFO_CTRL_LUTS;
+		res.ffs += fifos[s] * FIFO_CTRL_FFS;
+
+		if (s == 0)
+			continue;
+
+		// arbiterRR: previous winners and grant. collector_elem: read
+		// locks, a 64 bit ports:1 mux of LUT6 4:1 muxes and the read enables
+		const uint64_t muxLuts = 64 * ((ports - 1 + 2) / 3);
+		res.ffs += fifos[s] * (3 * ports + ports);
+		res.luts += fifos[s] * (6 * ports + muxLuts + 2 * ports);
+	}
+
+	return res;
+}
+
+double estimateClockMHz(const ModelConfig& cfg, double maxClockMHz)
+{
+	// lookup6 plus one level per adder stage
+	const uint32_t groups = (cfg.signatureLength + 5) / 6;
+	uint32_t levels = 1;
+
+	for (uint32_t terms = groups; terms > 1; terms = (terms + 1) / 2)
+		levels++;
+
+	const uint32_t levelsPerStage = (levels + cfg.pipelineStages - 1) / cfg.pipelineStages;
+	const double ns = NS_PER_STAGE_OVERHEAD + levelsPerStage * NS_PER_LOGIC_LEVEL;
+
+	return std::min(maxClockMHz, 1000.0 / ns);
+}
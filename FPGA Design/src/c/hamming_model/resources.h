@@ -0,0 +1,65 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "hamming_model.h"
+
+/* Resources of hamming_dist_top counted from the structure of the RTL, no
+ * synthesis involved. Registers are counted bit by bit. LUTs assume LUT6
+ * packing and carry chains for the adders. FIFO control logic and the
+ * AXI slave are fixed ballpark figures of the cores. Good enough to
+ * compare configurations and to see which ones can not fit. Expect a
+ * synthesis run to differ by some 10 %.
+ * */
+struct ResourceEstimate
+{
+	uint64_t luts;
+	uint64_t ffs;
+	double bram36; // RAMB36 equivalents, a RAMB18 counts half
+};
+
+ResourceEstimate estimateResources(const ModelConfig& cfg);
+
+/* Clock estimate of the HPE popcount path in MHz, capped at maxClockMHz.
+ * adder_via_lookup is a LUT6 lookup plus an adder tree in the first
+ * pipeline stage, the other PIPELINE_STAGES - 1 registers only delay the
+ * distance. With register retiming synthesis spreads the tree over all
+ * of them, so the logic levels per stage are divided by the stages.
+ * */
+double estimateClockMHz(const ModelConfig& cfg, double maxClockMHz);
+
+/* Resources of a device, the budget of an exploration */
+struct DeviceBudget
+{
+	const char* pName;
+	uint64_t luts;
+	uint64_t ffs;
+	double bram36;
+};
+
+// XC7VX690T of the Raptor DB-V7 and the VC709 targeted in sdaccel.mk
+#define DEFAULT_DEVICE_BUDGET { "xc7vx690t", 433200, 866400, 1470.0 }
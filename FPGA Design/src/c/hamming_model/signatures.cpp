@@ -0,0 +1,122 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "signatures.h"
+
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+bool readSignatures(const char* pFilename, uint32_t signatureLength, Signatures& data)
+{
+	std::ifstream infile(pFilename);
+
+	if (!infile.is_open())
+	{
+		std::cout << "Error while opening " << pFilename << std::endl;
+		return false;
+	}
+
+	std::string line;
+	size_t lineNo = 0;
+
+	while (std::getline(infile, line))
+	{
+		lineNo++;
+
+		size_t pos = line.compare(0, 2, "0x") == 0 ? 2 : 0;
+		if (line.find_first_not_of(" \t\r", pos) == std::string::npos)
+			continue;
+
+		Signature sig;
+
+		for (uint32_t d = 0; d < signatureLength / 4; d++, pos++)
+		{
+			const char c = pos < line.size() ? line[pos] : '\0';
+			int v;
+
+			if (c >= '0' && c <= '9')
+				v = c - '0';
+			else if (c >= 'a' && c <= 'f')
+				v = c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				v = c - 'A' + 10;
+			else
+			{
+				std::cout << "Malformed signature in line " << lineNo << " of " << pFilename << std::endl;
+				return false;
+			}
+
+			// The first digit of a byte is its upper nibble
+			const uint32_t base = (d / 2) * 8 + (d % 2 == 0 ? 4 : 0);
+
+			for (uint32_t b = 0; b < 4; b++)
+				sig[base + b] = (v >> b) & 1;
+		}
+
+		data.push_back(sig);
+	}
+
+	return true;
+}
+
+// Flips up to maxFlips random bits, the same bit may be hit twice
+static void flipBits(Signature& sig, uint32_t signatureLength, uint32_t maxFlips, std::mt19937_64& rng)
+{
+	const uint32_t flips = std::uniform_int_distribution<uint32_t>(0, maxFlips)(rng);
+	std::uniform_int_distribution<uint32_t> bit(0, signatureLength - 1);
+
+	for (uint32_t i = 0; i < flips; i++)
+		sig.flip(bit(rng));
+}
+
+void generateSignatures(const ModelConfig& cfg, size_t staticCount, size_t dynCount, double hitRate, uint64_t seed, Signatures& staticData, Signatures& dynData)
+{
+	std::mt19937_64 rng(seed);
+	std::bernoulli_distribution hit(hitRate);
+	const uint32_t radius = cfg.threshold > 0 ? (cfg.threshold - 1) / 2 : 0;
+
+	Signature base;
+	for (uint32_t i = 0; i < cfg.signatureLength; i++)
+		base[i] = rng() & 1;
+
+	Signature complement = base;
+	for (uint32_t i = 0; i < cfg.signatureLength; i++)
+		complement.flip(i);
+
+	for (size_t i = 0; i < staticCount; i++)
+	{
+		Signature sig = base;
+		flipBits(sig, cfg.signatureLength, radius, rng);
+		staticData.push_back(sig);
+	}
+
+	for (size_t i = 0; i < dynCount; i++)
+	{
+		Signature sig = hit(rng) ? base : complement;
+		flipBits(sig, cfg.signatureLength, radius, rng);
+		dynData.push_back(sig);
+	}
+}
@@ -0,0 +1,44 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "hamming_model.h"
+
+/* Reads one hex encoded signature per line, the format of the test data of
+ * the software engines. Only the first signatureLength / 4 digits of a
+ * line are used, two digits are a byte. Empty lines are skipped. Prints the
+ * first malformed line and returns false on failure.
+ * */
+bool readSignatures(const char* pFilename, uint32_t signatureLength, Signatures& data);
+
+/* Random signatures with a given share of hits. The static set is spread
+ * around a base signature, a dynamic signature is close to the base with
+ * probability hitRate and close to its complement otherwise. So it hits
+ * every or no signature A, for thresholds up to half the signature length.
+ * */
+void generateSignatures(const ModelConfig& cfg, size_t staticCount, size_t dynCount, double hitRate, uint64_t seed, Signatures& staticData, Signatures& dynData);
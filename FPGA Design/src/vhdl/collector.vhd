@@ -73,7 +73,9 @@ entity collector_elem is
     COL_RES_REQ_FIFO_EMPTY_OUT          : out std_logic; 
     COL_RES_REQ_FIFO_ALMOSTEMPTY_OUT    : out std_logic; 
     COL_RES_REQ_FIFO_ALMOSTFULL_OUT     : out std_logic; 
-    COL_RES_RD_EN_IN                    : in std_logic
+    COL_RES_RD_EN_IN                    : in std_logic;
+    --almost_full of any fifo in a stage, driven from this stage on for the performance counters
+    STAGE_ALMOSTFULL_OUT                : out std_logic_vector(COLLECTOR_STAGES-1 downto 0)
     );
 end collector_elem;
  
@@ -111,7 +113,9 @@ architecture RTL of collector_elem is
     COL_RES_REQ_FIFO_EMPTY_OUT          : out std_logic; 
     COL_RES_REQ_FIFO_ALMOSTEMPTY_OUT    : out std_logic; 
     COL_RES_REQ_FIFO_ALMOSTFULL_OUT     : out std_logic; 
-    COL_RES_RD_EN_IN                    : in std_logic
+    COL_RES_RD_EN_IN                    : in std_logic;
+    --almost_full of any fifo in a stage, driven from this stage on for the performance counters
+    STAGE_ALMOSTFULL_OUT                : out std_logic_vector(COLLECTOR_STAGES-1 downto 0)
     );
 END COMPONENT;
   
@@ -174,6 +178,7 @@ end component arbiterRR;
   signal collector_fifo_empty : array_ctrlsignals(0 to HPE_CNT_IN_EACH_STATE(CURRENT_COLLECTOR_STAGE)-1);
   signal collector_fifo_almostfull : array_ctrlsignals(0 to HPE_CNT_IN_EACH_STATE(CURRENT_COLLECTOR_STAGE)-1);
   signal collector_fifo_almostempty : array_ctrlsignals(0 to HPE_CNT_IN_EACH_STATE(CURRENT_COLLECTOR_STAGE)-1); 
+  signal next_stage_almostfull : std_logic_vector(COLLECTOR_STAGES-1 downto 0) := (others => '0');
  
    --helper signals
   signal next_fifo_lock_rd     : std_logic_vector(HPE_CNT_IN_EACH_STATE(CURRENT_COLLECTOR_STAGE-1)-1 downto 0);
@@ -277,7 +282,8 @@ begin
     COL_RES_REQ_FIFO_EMPTY_OUT          => COL_RES_REQ_FIFO_EMPTY_OUT,
     COL_RES_REQ_FIFO_ALMOSTEMPTY_OUT    => COL_RES_REQ_FIFO_ALMOSTEMPTY_OUT,
     COL_RES_REQ_FIFO_ALMOSTFULL_OUT     => COL_RES_REQ_FIFO_ALMOSTFULL_OUT,
-    COL_RES_RD_EN_IN                    => COL_RES_RD_EN_IN
+    COL_RES_RD_EN_IN                    => COL_RES_RD_EN_IN,
+    STAGE_ALMOSTFULL_OUT                => next_stage_almostfull
     );
   end generate CX;
 
@@ -327,12 +333,15 @@ begin
       for k in 0 to PORTS_PER_ARBITER-1 loop  
         if ((arbiter_tree_grant_out(i)(k) = '1') and ((i*PORTS_PER_ARBITER+k) < HPE_CNT_IN_EACH_STATE(CURRENT_COLLECTOR_STAGE-1))) then
             if (current_fifo_lock_rd (i*PORTS_PER_ARBITER+k) = '0') then
+              --the grant is held while this fifo is full, the granted fifo can run empty in the meantime
+              if (ARBITER_REQ_FIFO_EMPTY_IN(i*PORTS_PER_ARBITER+k) = '0') then
                   if(ARBITER_REQ_FIFO_ALMOSTEMPTY_IN(i*PORTS_PER_ARBITER+k) = '1') then 
                     next_fifo_lock_rd(i*PORTS_PER_ARBITER+k) <= '1';
                   end if;       
-              collector_fifo_din(i) <= ARBITER_REQ_FIFO_DATA_IN((i*PORTS_PER_ARBITER+k));
-              ARBITER_GNT_RD_EN_OUT(i*PORTS_PER_ARBITER+k) <= '1'; 
-              collector_fifo_wr_en(i) <= arbiter_tree_grant_out(i)(k);
+                collector_fifo_din(i) <= ARBITER_REQ_FIFO_DATA_IN((i*PORTS_PER_ARBITER+k));
+                ARBITER_GNT_RD_EN_OUT(i*PORTS_PER_ARBITER+k) <= '1'; 
+                collector_fifo_wr_en(i) <= arbiter_tree_grant_out(i)(k);
+              end if;
             else
                next_fifo_lock_rd(i*PORTS_PER_ARBITER+k) <= '0';
             end if;
@@ -344,6 +353,18 @@ begin
 end process;
 
 
+--almost_full of this stage, the later stages come from the next recursion
+STAGE_ALMOSTFULL_P : process(collector_fifo_almostfull, next_stage_almostfull)
+begin
+  STAGE_ALMOSTFULL_OUT <= next_stage_almostfull;
+  STAGE_ALMOSTFULL_OUT(CURRENT_COLLECTOR_STAGE) <= '0';
+  for i in 0 to HPE_CNT_IN_EACH_STATE(CURRENT_COLLECTOR_STAGE)-1 loop
+    if (collector_fifo_almostfull(i) = '1') then
+      STAGE_ALMOSTFULL_OUT(CURRENT_COLLECTOR_STAGE) <= '1';
+    end if;
+  end loop;
+end process;
+
 sw_reg_p : process(CLK_IN)
   begin
     if (rising_edge(CLK_IN)) then
@@ -69,7 +69,8 @@ entity collector_wrapper is
     COL_RESULTS_FIFO_DATA_OUT           : out  std_logic_vector(127 downto 0); 
     COL_RESULTS_FIFO_EMPTY_OUT          : out  std_logic; 
     COL_RESULTS_FIFO_ALMOSTEMPTY_OUT    : out  std_logic; 
-    ENABLE_HPE_OUT                        : out std_logic -- = almostfull to stop hpe in time to not loose any results
+    ENABLE_HPE_OUT                        : out std_logic; -- = almostfull to stop hpe in time to not loose any results
+    STAGE_ALMOSTFULL_OUT                  : out std_logic_vector(COLLECTOR_STAGES-1 downto 0) -- almost_full of any fifo, per stage
   );
 end collector_wrapper;
 
@@ -124,7 +125,8 @@ COMPONENT collector_elem
     COL_RES_REQ_FIFO_EMPTY_OUT          : out std_logic; 
     COL_RES_REQ_FIFO_ALMOSTEMPTY_OUT    : out std_logic; 
     COL_RES_REQ_FIFO_ALMOSTFULL_OUT     : out std_logic; 
-    COL_RES_RD_EN_IN                    : in std_logic
+    COL_RES_RD_EN_IN                    : in std_logic;
+    STAGE_ALMOSTFULL_OUT                : out std_logic_vector(COLLECTOR_STAGES-1 downto 0)
     );
 END COMPONENT;
 
@@ -148,11 +150,23 @@ END COMPONENT;
   signal pefifo_almostempty : array_ctrlsignals(0 to NUMBER_OF_HAMMING_ELEMENTS-1);
   
   signal fifo_reset : std_logic;
+  signal collector_almostfull : std_logic_vector(COLLECTOR_STAGES-1 downto 0);
+
+  --The HPE are stopped before a fifo is full. With one signature B per cycle every HPE can write a result per cycle,
+  --until the stop reaches the HPE clock some more results arrive: fill count register, the two enable delay registers
+  --in the top level, the threshold checker register and the HPE output that is still enabled.
+  constant PEFIFO_DEPTH : integer := 32;
+  constant PEFIFO_STOP_MARGIN : integer := 8;
+  type array_pefifo_count is array (0 to NUMBER_OF_HAMMING_ELEMENTS-1) of integer range 0 to PEFIFO_DEPTH;
+  signal pefifo_count : array_pefifo_count := (others => 0);
+  signal pefifo_stop : array_ctrlsignals(0 to NUMBER_OF_HAMMING_ELEMENTS-1);
 
 ---------
 begin  --
 ---------
-   ENABLE_HPE_OUT <= '1' when unsigned(pefifo_almostfull) = to_unsigned(0, pefifo_almostfull'length) else '0'; 
+   ENABLE_HPE_OUT <= '1' when unsigned(pefifo_stop) = to_unsigned(0, pefifo_stop'length) else '0'; 
+   STAGE_ALMOSTFULL_OUT(COLLECTOR_STAGES-1 downto 1) <= collector_almostfull(COLLECTOR_STAGES-1 downto 1);
+   STAGE_ALMOSTFULL_OUT(0) <= '0' when unsigned(pefifo_almostfull) = to_unsigned(0, pefifo_almostfull'length) else '1'; 
    fifo_reset <= not RESET_N_IN;
    
   -------------------------------
@@ -199,6 +213,41 @@ collector_stage1 : collector_elem
     COL_RES_REQ_FIFO_EMPTY_OUT          => COL_RESULTS_FIFO_EMPTY_OUT,
     COL_RES_REQ_FIFO_ALMOSTEMPTY_OUT    => COL_RESULTS_FIFO_ALMOSTEMPTY_OUT,
     COL_RES_REQ_FIFO_ALMOSTFULL_OUT     => open, 
-    COL_RES_RD_EN_IN                    => READ_COL_FIFO_RESULTS
+    COL_RES_RD_EN_IN                    => READ_COL_FIFO_RESULTS,
+    STAGE_ALMOSTFULL_OUT                => collector_almostfull
     );
+  -----------------
+  --  PROCESSES  --
+  -----------------
+  --fill level of every HPE fifo, granted reads of an empty fifo do not count
+  pefifo_count_p : process(CLK_IN)
+  begin
+    if (rising_edge(CLK_IN)) then
+      if (RESET_N_IN = '0') then
+        pefifo_count <= (others => 0);
+      else
+        for i in 0 to NUMBER_OF_HAMMING_ELEMENTS-1 loop
+          if (HPE_RESULTS_WR_REQ_IN(i) = '1' and not (pefifo_rd_en(i) = '1' and pefifo_empty(i) = '0')) then
+            if (pefifo_count(i) < PEFIFO_DEPTH) then
+              pefifo_count(i) <= pefifo_count(i) + 1;
+            end if;
+          elsif (HPE_RESULTS_WR_REQ_IN(i) = '0' and pefifo_rd_en(i) = '1' and pefifo_empty(i) = '0') then
+            pefifo_count(i) <= pefifo_count(i) - 1;
+          end if;
+        end loop;
+      end if;
+    end if;
+  end process pefifo_count_p;
+
+  pefifo_stop_p : process(pefifo_count)
+  begin
+    for i in 0 to NUMBER_OF_HAMMING_ELEMENTS-1 loop
+      if (pefifo_count(i) >= PEFIFO_DEPTH - PEFIFO_STOP_MARGIN) then
+        pefifo_stop(i) <= '1';
+      else
+        pefifo_stop(i) <= '0';
+      end if;
+    end loop;
+  end process pefifo_stop_p;
+
 end RTL;     
\ No newline at end of file
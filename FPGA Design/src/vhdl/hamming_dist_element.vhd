@@ -61,6 +61,7 @@ entity hamming_dist_elem is
     RESET_N_IN                : in  std_logic;
     SIG1_IDX_IN               : in unsigned (26 downto 0);
     SIG2_IDX_IN               : in unsigned (26 downto 0);
+    SIG2_IDX_OUT              : out unsigned (26 downto 0); --index travelling with SIGNATURE_2_OUT
     SIGNATURE_1_IN            : in  unsigned(SIGNATURE_LENGTH-1 downto 0);
     SIGNATURE_1_SHIFT_IN      : in std_logic; 
     SIGNATURE_1_OUT           : out  unsigned(SIGNATURE_LENGTH-1 downto 0);
@@ -92,6 +93,9 @@ architecture RTL of hamming_dist_elem is
   type HAMMING_DIST_CALC_TYPE is array ((PIPELINE_STAGES -1) downto 0) of std_logic_vector(HAMMING_DIST_OUT_LENGTH downto 0);
   signal current_hamming_dist_pipe : HAMMING_DIST_CALC_TYPE := (others =>  (others => '0'));  
   signal current_hamming_dist_valid_pipe : std_logic_vector(PIPELINE_STAGES downto 0) := (others => '0');
+  --index of signature 2, moves with the valid pipe so every result carries the index of its own signature
+  type SIG2_IDX_PIPE_TYPE is array (PIPELINE_STAGES downto 0) of unsigned(26 downto 0);
+  signal current_sig2_idx_pipe : SIG2_IDX_PIPE_TYPE := (others => (others => '0'));
   
   signal current_signature_2_in : unsigned(SIGNATURE_LENGTH-1 downto 0);
   signal current_signature_1_in : unsigned(SIGNATURE_LENGTH-1 downto 0);
@@ -226,7 +230,8 @@ begin  --
     HAMMING_DIST_VALID_OUT <= hamming_dist_valid_out_mux; 
     HAMMING_DIST_OUT(9 downto HAMMING_DIST_OUT_LENGTH+1) <= (others => '0');
     HAMMING_DIST_OUT(HAMMING_DIST_OUT_LENGTH downto 0) <= current_hamming_dist_pipe(PIPELINE_STAGES -1);
-    HAMMING_DIST_OUT(36 downto 10) <= std_logic_vector(SIG2_IDX_IN);
+    HAMMING_DIST_OUT(36 downto 10) <= std_logic_vector(current_sig2_idx_pipe(PIPELINE_STAGES));
+    SIG2_IDX_OUT <= current_sig2_idx_pipe(1);
     HAMMING_DIST_OUT(63 downto 37) <= std_logic_vector(SIG1_IDX_IN);
     
     SIGNATURE_1_SHIFT_OUT <= SIGNATURE_1_SHIFT_IN;
@@ -249,6 +254,8 @@ begin  --
     elsif (rising_edge(CLK_HPE_GATED_IN)) then --TODO?
         current_hamming_dist_valid_pipe(0) <= SIGNATURE_2_VALID_IN;
         current_hamming_dist_valid_pipe(PIPELINE_STAGES downto 1) <= current_hamming_dist_valid_pipe(PIPELINE_STAGES-1 downto 0); --changed due to new registerd xor stage 
+        current_sig2_idx_pipe(0) <= SIG2_IDX_IN;
+        current_sig2_idx_pipe(PIPELINE_STAGES downto 1) <= current_sig2_idx_pipe(PIPELINE_STAGES-1 downto 0);
         current_hamming_dist_pipe(0) <= adder_via_lookup(c_xor_result);
         current_hamming_dist_pipe(PIPELINE_STAGES -1 downto 1) <= current_hamming_dist_pipe(PIPELINE_STAGES-2 downto 0);
         c_xor_result <= gen_length_xor(current_signature_1_in, SIGNATURE_2_IN); --bei SIGNATURE_1_IN haben 0 und 1 HPE selben inhalt.. bei current stimmt alles.--
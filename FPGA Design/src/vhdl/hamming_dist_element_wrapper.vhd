@@ -89,7 +89,7 @@ architecture RTL of hamming_dist_element_wrapper is
   signal hamming_dist_out_genl : array_pefifo_inoutputs_genlength(0 to NUMBER_OF_HAMMING_ELEMENTS - 1) := (others => (others => '0'));
 
   ---idx for signatures
-  type idx_signal is array (0 to NUMBER_OF_HAMMING_ELEMENTS-1) of unsigned (26 downto 0);
+  type idx_signal is array (0 to NUMBER_OF_HAMMING_ELEMENTS) of unsigned (26 downto 0);
   signal next_signature_1_idx    : idx_signal;
   signal current_signature_2_idx : idx_signal := (others => (others => '0'));
   signal next_signature_2_idx    : idx_signal;
@@ -134,6 +134,7 @@ begin  --
               RESET_N_IN                => RESET_N_IN,
               SIG1_IDX_IN               => to_unsigned(i, 27),
               SIG2_IDX_IN               => SIGNATURE_B_IDX_IN,
+              SIG2_IDX_OUT              => next_signature_2_idx(i+1),
               SIGNATURE_1_IN            => SIGNATURE_A_IN,
               SIGNATURE_1_SHIFT_IN      => SIGNATURE_A_VALID_IN,
               SIGNATURE_1_OUT           => next_signature_A(0),
@@ -161,7 +162,8 @@ begin  --
               CLK_IN            => CLK_IN,
               RESET_N_IN        => RESET_N_IN,
               SIG1_IDX_IN               => to_unsigned(i, 27),
-              SIG2_IDX_IN               => unsigned(hamming_dist_out_genl(i-1)(36 downto 10)),
+              SIG2_IDX_IN               => current_signature_2_idx(i),
+              SIG2_IDX_OUT              => next_signature_2_idx(i+1),
               SIGNATURE_1_IN            => current_signature_A(i),
               SIGNATURE_1_SHIFT_IN      => sig_a_shift(i), 
               SIGNATURE_1_OUT           => next_signature_A(i+1),
@@ -190,6 +192,7 @@ begin  --
   --  CONCURRENT STATEMENTS  --
   -----------------------------
     next_signature_A(1) <= current_signature_A(0);
+    next_signature_2_idx(0) <= SIGNATURE_B_IDX_IN;
     
   -----------------
   --  PROCESSES  --
@@ -199,11 +202,12 @@ begin  --
   begin
     if (rising_edge(CLK_IN)) then
         current_signature_A <= next_signature_A;
-        current_signature_B <= next_signature_B;
       if (RESET_N_IN = '0') then
         current_sig_B_valids <= (others => '0');
         current_signature_2_idx <= (others => (others => '0'));
-  else
+  elsif (GLOBAL_ENABLE = '1') then
+        --signature B registers hold while the HPE clock is gated, else a B between two elements is lost
+        current_signature_B <= next_signature_B;
         current_signature_2_idx <= next_signature_2_idx;
         current_sig_B_valids <= next_sig_B_valids;
       end if;
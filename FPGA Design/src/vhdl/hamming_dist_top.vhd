@@ -62,7 +62,7 @@ entity hamming_dist_top is
     SIGNATURE_LENGTH  : in integer;          --Given signature length
     NUMBER_OF_HAMMING_ELEMENTS : in integer; --Number of used HPE
     PIPELINE_STAGES   : in integer;          --Number of Pipeline Stages for the collector unit
-    THRESHOLD         : in integer;          --Only results below this threshold value will be stored in the result fifo
+    THRESHOLD         : in integer;          --Only results below this threshold value will be stored in the result fifo, value after reset of the threshold register
     PORTS_PER_ARBITER : in integer range 2 to 20 ; ---number of ports for each fifo arbiter of the collector unit
     -- AXI Full Slave	
 		C_S_AXI_ID_WIDTH	  : integer	:= 1; -- Width of ID for for write address, write data, read address and read data
@@ -127,7 +127,12 @@ entity hamming_dist_top is
 		S_AXI_RLAST	  : out std_logic;
 		S_AXI_RUSER	  : out std_logic_vector(C_S_AXI_RUSER_WIDTH-1 downto 0);
 		S_AXI_RVALID	: out std_logic;
-		S_AXI_RREADY	: in std_logic
+		S_AXI_RREADY	: in std_logic;
+		-- AXI4-Stream Slave, signatures B from a DMA engine, one signature per beat
+		S_AXIS_TDATA	: in std_logic_vector(SIGNATURE_LENGTH-1 downto 0);
+		S_AXIS_TVALID	: in std_logic;
+		S_AXIS_TREADY	: out std_logic;
+		S_AXIS_TLAST	: in std_logic -- not used, every beat is a complete signature
   );
 end hamming_dist_top;
 
@@ -185,7 +190,8 @@ architecture RTL of hamming_dist_top is
       COL_RESULTS_FIFO_DATA_OUT           : out  std_logic_vector(127 downto 0); 
       COL_RESULTS_FIFO_EMPTY_OUT          : out  std_logic; 
       COL_RESULTS_FIFO_ALMOSTEMPTY_OUT    : out  std_logic; 
-      ENABLE_HPE_OUT                        : out std_logic -- = almostfull
+      ENABLE_HPE_OUT                        : out std_logic; -- = almostfull
+      STAGE_ALMOSTFULL_OUT                  : out std_logic_vector(COLLECTOR_STAGES-1 downto 0)
     );
   end component;
 
@@ -198,6 +204,8 @@ architecture RTL of hamming_dist_top is
    port(
      CLK_IN               : in  std_logic;
      RESET_N_IN           : in  std_logic;
+     THRESHOLD_IN            : in  unsigned(9 downto 0);
+     THRESHOLD_LATCH_IN      : in  std_logic;
      HPE_RESULTS_IN          : in  array_pefifo_inoutputs_genlength(0 to NUMBER_OF_HAMMING_ELEMENTS-1); 
      HPE_RESULTS_WR_REQ_IN   : in  unsigned(NUMBER_OF_HAMMING_ELEMENTS-1 downto 0);
      HPE_RESULTS_OUT         : out  array_pefifo_inoutputs_genlength(0 to NUMBER_OF_HAMMING_ELEMENTS-1); 
@@ -231,7 +239,8 @@ architecture RTL of hamming_dist_top is
  
   --Softwear controll states
   type SW_CTRL_STATE is (IDLE, RESET, WRITE_SIG_A, WRITE_SIG_B, READ_FIFO_OUTPUT, READ_FIFO_OUTPUT_ALL_DDR_BYPASS_0,
-                         READ_FIFO_OUTPUT_ALL_DDR_BYPASS_1, READ_FIFO_OUTPUT_ALL_DDR_BYPASS_2, READ_FIFO_OUTPUT_ALL_DDR_BYPASS_3);
+                         READ_FIFO_OUTPUT_ALL_DDR_BYPASS_1, READ_FIFO_OUTPUT_ALL_DDR_BYPASS_2, READ_FIFO_OUTPUT_ALL_DDR_BYPASS_3,
+                         READ_THRESHOLD, READ_COUNTERS);
   signal current_sw_state : SW_CTRL_STATE;
   signal next_sw_state    : SW_CTRL_STATE;
   
@@ -255,6 +264,15 @@ architecture RTL of hamming_dist_top is
   signal current_sig_B_valids : std_logic := '0'; 
   signal next_sig_B_valids : std_logic; 
 
+  --Signature B from the stream, held while the HPE clock is disabled
+  signal current_sig_B_stream : std_logic := '0';
+  signal next_sig_B_stream : std_logic;
+  signal stream_ready : std_logic;
+
+  --Index of the signature B register, travels with the signature through the HPE
+  signal current_sig_B_idx : unsigned (26 downto 0) := (others => '0');
+  signal next_sig_B_idx    : unsigned (26 downto 0);
+
   constant SIG_B_WR_CNT_MAX : integer := SIGNATURE_LENGTH / 32;
   
   --Signature counter
@@ -263,6 +281,27 @@ architecture RTL of hamming_dist_top is
   signal current_sigB_cnt : integer range 0 to SIG_B_WR_CNT_MAX := 0;
   signal next_sigB_cnt    : integer range 0 to SIG_B_WR_CNT_MAX;
 
+  --Threshold register, written by software and taken over by the threshold checker with the signatures A of a job
+  signal current_threshold : unsigned(9 downto 0) := to_unsigned(THRESHOLD, 10);
+
+  --Performance counters, free running since reset. Software reads a snapshot taken at the start of a read burst
+  --at address 0x400: COLLECTOR_STAGES, NUMBER_OF_HAMMING_ELEMENTS and then every counter as low and high word
+  constant PERF_CYCLES      : integer := 0; --all clock cycles
+  constant PERF_BUSY        : integer := 1; --cycles with an S_AXI burst in progress
+  constant PERF_COMPARISONS : integer := 2; --valid HPE results
+  constant PERF_HITS        : integer := 3; --results forwarded by the threshold checker
+  constant PERF_STALLS      : integer := 4; --cycles with the HPE clock disabled
+  constant PERF_STREAM      : integer := 5; --signatures B taken from S_AXIS
+  constant PERF_ALMOSTFULL  : integer := 6; --cycles with almost_full in a collector stage, one counter per stage
+  constant PERF_COUNTERS    : integer := PERF_ALMOSTFULL + COLLECTOR_STAGES;
+  type array_perf_counters is array (0 to PERF_COUNTERS-1) of unsigned(63 downto 0);
+  signal perf_counters : array_perf_counters := (others => (others => '0'));
+  signal perf_snapshot : array_perf_counters := (others => (others => '0'));
+  signal perf_read_word : std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+  signal comparisons_d1 : unsigned(integer(ceil(log2(real(NUMBER_OF_HAMMING_ELEMENTS+1))))-1 downto 0) := (others => '0');
+  signal hits_d1 : unsigned(integer(ceil(log2(real(NUMBER_OF_HAMMING_ELEMENTS+1))))-1 downto 0) := (others => '0');
+  signal collector_almostfull : std_logic_vector(COLLECTOR_STAGES-1 downto 0);
+
   --Result fifo output signals to split 128bit into 32bit readable output
   signal n_resultfifo_cnt : integer range 0 to 4;
   signal c_resultfifo_cnt : integer range 0 to 4 := 0;
@@ -353,6 +392,17 @@ architecture RTL of hamming_dist_top is
   -------------------
   -----Functions-----
   -------------------
+  --number of set bits, used to count the valids of all HPE in a cycle
+  function COUNT_ONES (VALUES : unsigned; WIDTH : integer) return unsigned is
+  variable CNT : integer range 0 to VALUES'length := 0;
+  begin
+    for i in VALUES'range loop
+      if (VALUES(i) = '1') then
+        CNT := CNT + 1;
+      end if;
+    end loop;
+  return to_unsigned(CNT, WIDTH);
+  end COUNT_ONES;
 
 
 
@@ -393,7 +443,8 @@ collector_wrapper_inst : collector_wrapper
     COL_RESULTS_FIFO_DATA_OUT           => read_results_fifo_data,
     COL_RESULTS_FIFO_EMPTY_OUT          => read_results_fifo_empty,
     COL_RESULTS_FIFO_ALMOSTEMPTY_OUT    => read_results_fifo_almostempty,
-    ENABLE_HPE_OUT                        => enable_hpe_d0
+    ENABLE_HPE_OUT                        => enable_hpe_d0,
+    STAGE_ALMOSTFULL_OUT                  => collector_almostfull
   );
 
 
@@ -405,6 +456,8 @@ collector_wrapper_inst : collector_wrapper
   port map(
     CLK_IN                  =>  S_AXI_ACLK,
     RESET_N_IN              =>  S_AXI_ARESETN,
+    THRESHOLD_IN            =>  current_threshold,
+    THRESHOLD_LATCH_IN      =>  current_sig_A_valids,
     HPE_RESULTS_IN          =>  hpe_result_array,
     HPE_RESULTS_WR_REQ_IN   =>  hpe_result_valid,
     HPE_RESULTS_OUT         =>  hpe_result_array_t, 
@@ -431,7 +484,7 @@ collector_wrapper_inst : collector_wrapper
     SIGNATURE_A_IDX_IN          => current_signature_1_idx,
     SIGNATURE_B_IN              => current_signature_B,
     SIGNATURE_B_VALID_IN        => current_sig_B_valids,
-    SIGNATURE_B_IDX_IN          => current_signature_2_idx,
+    SIGNATURE_B_IDX_IN          => current_sig_B_idx,
     GLOBAL_ENABLE               => enable_hpe_d2
   );
   
@@ -451,6 +504,7 @@ collector_wrapper_inst : collector_wrapper
 	S_AXI_RVALID	<= axi_rvalid;
 	S_AXI_BID <= S_AXI_AWID;
 	S_AXI_RID <= S_AXI_ARID;
+	S_AXIS_TREADY <= stream_ready;
 	aw_wrap_size <= ((C_S_AXI_DATA_WIDTH)/8 * to_integer(unsigned(axi_awlen))); 
 	ar_wrap_size <= ((C_S_AXI_DATA_WIDTH)/8 * to_integer(unsigned(axi_arlen))); 
 	aw_wrap_en <= '1' when (((axi_awaddr AND std_logic_vector(to_unsigned(aw_wrap_size,C_S_AXI_ADDR_WIDTH))) XOR std_logic_vector(to_unsigned(aw_wrap_size,C_S_AXI_ADDR_WIDTH))) = low) else '0';
@@ -459,6 +513,10 @@ collector_wrapper_inst : collector_wrapper
   -----------------------------
   --  CONCURRENT STATEMENTS  --
   -----------------------------
+  --A stream beat is taken when the B register is free or the HPE take its signature with this clock. The
+  --collector stops the HPE clock, so it back-pressures the stream. A job uses either the stream or S_AXI
+  --writes for its signatures B.
+  stream_ready <= '1' when ((current_sig_B_valids = '0' or enable_hpe_d2 = '1') and current_sw_state /= WRITE_SIG_B and current_sw_state /= RESET) else '0';
     
   -----------------
   --  PROCESSES  --
@@ -559,6 +617,93 @@ collector_wrapper_inst : collector_wrapper
   
   
   
+	-- Implement the threshold register
+
+	-- The register is written with the beat handshake like the memory of
+	-- the AXI template, software writes it at address 0x200. The software
+	-- FSM stays in IDLE for this address. Only the lower 10 bits are used,
+	-- like the distance field of the results.
+
+	process (S_AXI_ACLK)
+	begin
+	  if rising_edge(S_AXI_ACLK) then 
+	    if S_AXI_ARESETN = '0' then
+	      current_threshold <= to_unsigned(THRESHOLD, current_threshold'length);
+	    else
+	      if (axi_wready = '1' and S_AXI_WVALID = '1' and axi_awv_awr_flag = '1' and axi_awaddr(11) = '0' and axi_awaddr(9) = '1') then
+	        current_threshold <= unsigned(S_AXI_WDATA(9 downto 0));
+	      end if;
+	    end if;
+	  end if;         
+	end process; 
+  
+	-- Implement the performance counters
+
+	-- The counts of valid results are registered once to keep the adder
+	-- trees out of the counter path. The snapshot is taken when the
+	-- software FSM starts a read of the counters, so all words of a burst
+	-- belong to the same cycle.
+
+	process (S_AXI_ACLK)
+	begin
+	  if rising_edge(S_AXI_ACLK) then 
+	    if (current_sw_state = IDLE and next_sw_state = READ_COUNTERS) then
+	      perf_snapshot <= perf_counters;
+	    end if;
+
+	    if S_AXI_ARESETN = '0' then
+	      perf_counters <= (others => (others => '0'));
+	      comparisons_d1 <= (others => '0');
+	      hits_d1 <= (others => '0');
+	    else
+	      comparisons_d1 <= COUNT_ONES(hpe_result_valid, comparisons_d1'length);
+	      hits_d1 <= COUNT_ONES(hpe_result_valid_t, hits_d1'length);
+
+	      perf_counters(PERF_CYCLES) <= perf_counters(PERF_CYCLES) + 1;
+	      perf_counters(PERF_COMPARISONS) <= perf_counters(PERF_COMPARISONS) + comparisons_d1;
+	      perf_counters(PERF_HITS) <= perf_counters(PERF_HITS) + hits_d1;
+
+	      if (axi_awv_awr_flag = '1' or axi_arv_arr_flag = '1') then
+	        perf_counters(PERF_BUSY) <= perf_counters(PERF_BUSY) + 1;
+	      end if;
+
+	      if (enable_hpe_d2 = '0') then
+	        perf_counters(PERF_STALLS) <= perf_counters(PERF_STALLS) + 1;
+	      end if;
+
+	      if (stream_ready = '1' and S_AXIS_TVALID = '1') then
+	        perf_counters(PERF_STREAM) <= perf_counters(PERF_STREAM) + 1;
+	      end if;
+
+	      for i in 0 to COLLECTOR_STAGES-1 loop
+	        if (collector_almostfull(i) = '1') then
+	          perf_counters(PERF_ALMOSTFULL + i) <= perf_counters(PERF_ALMOSTFULL + i) + 1;
+	        end if;
+	      end loop;
+	    end if;
+	  end if;         
+	end process; 
+
+	-- word of the counter snapshot at the current read address
+	process (axi_araddr, perf_snapshot)
+	variable word : integer;
+	begin
+	  word := to_integer(unsigned(axi_araddr(9 downto ADDR_LSB)));
+	  perf_read_word <= (others => '0');
+
+	  if (word = 0) then
+	    perf_read_word <= std_logic_vector(to_unsigned(COLLECTOR_STAGES, C_S_AXI_DATA_WIDTH));
+	  elsif (word = 1) then
+	    perf_read_word <= std_logic_vector(to_unsigned(NUMBER_OF_HAMMING_ELEMENTS, C_S_AXI_DATA_WIDTH));
+	  elsif (word < 2 + 2 * PERF_COUNTERS) then
+	    if (word mod 2 = 0) then
+	      perf_read_word <= std_logic_vector(perf_snapshot((word - 2) / 2)(31 downto 0));
+	    else
+	      perf_read_word <= std_logic_vector(perf_snapshot((word - 2) / 2)(63 downto 32));
+	    end if;
+	  end if;
+	end process;
+  
 	-- Implement axi_wready generation
 
 	-- axi_wready is asserted for one S_AXI_ACLK clock cycle when both
@@ -728,7 +873,8 @@ collector_wrapper_inst : collector_wrapper
                            current_signature_A,current_signature_B,
                            read_results_fifo_data, read_results_fifo_empty, c_store_128bit_resultfifo, c_resultfifo_cnt,
                            current_signature_2_idx, current_signature_1_idx, w_accepted, w_finished, S_AXI_RREADY, 
-                           axi_rvalid, current_sig_B_valids)
+                           axi_rvalid, current_sig_B_valids, current_threshold, perf_read_word,
+                           current_sig_B_stream, current_sig_B_idx, stream_ready, enable_hpe_d2, S_AXIS_TVALID, S_AXIS_TDATA)
   begin
     next_sw_state             <= current_sw_state ;
     axi_rdata                 <= c_store_128bit_resultfifo(31 downto 0);
@@ -737,6 +883,8 @@ collector_wrapper_inst : collector_wrapper
     next_signature_A          <= current_signature_A;
     next_signature_B          <= current_signature_B;
     next_sig_B_valids         <=  '0'; 
+    next_sig_B_stream         <= '0';
+    next_sig_B_idx            <= current_sig_B_idx;
     n_resultfifo_cnt          <= c_resultfifo_cnt;
     n_store_128bit_resultfifo <= c_store_128bit_resultfifo; 
     next_signature_1_idx      <= current_signature_1_idx;
@@ -753,6 +901,7 @@ collector_wrapper_inst : collector_wrapper
         next_signature_B <= (others => '0');
         next_sig_A_valids <= '0';
         next_sig_B_valids <= '0';
+        next_sig_B_idx <= (others => '0');
         n_resultfifo_cnt <= 0;
         n_store_128bit_resultfifo <= (others => '0');
         next_signature_1_idx <= (others => '0');
@@ -769,8 +918,12 @@ collector_wrapper_inst : collector_wrapper
               next_sw_state  <= WRITE_SIG_B ;
         end if;
       elsif(axi_arv_arr_flag = '1') then --valid read address
-        if  (axi_araddr(8) = '1') then
+        if  (axi_araddr(10) = '1') then
+               next_sw_state <= READ_COUNTERS;
+        elsif (axi_araddr(8) = '1') then
                next_sw_state <= READ_FIFO_OUTPUT;
+        elsif (axi_araddr(9) = '1') then
+               next_sw_state <= READ_THRESHOLD;
          end if;
       end if;
       
@@ -815,6 +968,7 @@ collector_wrapper_inst : collector_wrapper
           
           if ((current_sigB_cnt = SIG_B_WR_CNT_MAX-1) and (current_sig_B_valids = '0')) then
             next_sig_B_valids <= '1';
+            next_sig_B_idx <= current_signature_2_idx +1; --counter steps with the write response
             next_sigB_cnt <= 0;
           elsif (current_sigB_cnt = SIG_B_WR_CNT_MAX-1) then
             next_sigB_cnt <= 0;
@@ -865,9 +1019,35 @@ collector_wrapper_inst : collector_wrapper
            end if;
           end if;       
     
+      when READ_THRESHOLD =>    -- every beat returns the threshold register
+          axi_rdata <= std_logic_vector(resize(current_threshold, C_S_AXI_DATA_WIDTH));
+          if (S_AXI_RREADY = '1' and axi_rvalid = '1' and axi_rlast = '1') then
+           next_sw_state <= IDLE; 
+          end if;
+
+      when READ_COUNTERS =>     -- one word of the counter snapshot per beat, addressed by the burst
+          axi_rdata <= perf_read_word;
+          if (S_AXI_RREADY = '1' and axi_rvalid = '1' and axi_rlast = '1') then
+           next_sw_state <= IDLE; 
+          end if;
+    
 
     end case;
 
+    --signatures B from the stream
+    if (current_sw_state /= RESET) then
+      if (current_sig_B_stream = '1' and current_sig_B_valids = '1' and enable_hpe_d2 = '0') then
+        next_sig_B_valids <= '1';
+        next_sig_B_stream <= '1';
+      elsif (stream_ready = '1' and S_AXIS_TVALID = '1') then
+        next_signature_B <= unsigned(S_AXIS_TDATA);
+        next_sig_B_valids <= '1';
+        next_sig_B_stream <= '1';
+        next_sig_B_idx <= current_signature_2_idx +1;
+        next_signature_2_idx <= current_signature_2_idx +1;
+      end if;
+    end if;
+
   end process software_ctrl_p;
   
   
@@ -888,6 +1068,8 @@ collector_wrapper_inst : collector_wrapper
         current_signature_2_idx <= next_signature_2_idx;
         current_sig_A_valids <= next_sig_A_valids;
         current_sig_B_valids <= next_sig_B_valids;
+        current_sig_B_stream <= next_sig_B_stream;
+        current_sig_B_idx <= next_sig_B_idx;
         c_resultfifo_cnt <= n_resultfifo_cnt;
         c_store_128bit_resultfifo <= n_store_128bit_resultfifo;
 				
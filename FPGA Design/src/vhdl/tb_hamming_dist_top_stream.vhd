@@ -0,0 +1,583 @@
+-- Copyright (c) 2017 Martin Kaiser and Sarah Pilz
+--
+-- Permission is hereby granted, free of charge, to any person obtaining a copy
+-- of this software and associated documentation files (the "Software"), to deal
+-- in the Software without restriction, including without limitation the rights
+-- to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+-- copies of the Software, and to permit persons to whom the Software is
+-- furnished to do so, subject to the following conditions:
+--
+-- The above copyright notice and this permission notice shall be included in
+-- all copies or substantial portions of the Software.
+--
+-- THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+-- IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+-- FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+-- AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+-- LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+-- OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+-- THE SOFTWARE.
+--------------------------------------------------------------------------------
+-- CITEC - Center of Excellence Cognitive Interaction Technology
+-- Bielefeld University
+-- Cognitronics & Sensor Systems
+--
+-- File Name   : tb_hamming_dist_top_stream.vhd
+-- Author      : Martin Kaiser and Sarah Pilz
+-- Description : Testbench for the S_AXIS ingest of hamming_dist_top. Signatures A
+--               and the threshold are written with S_AXI bursts, signatures B are
+--               streamed with S_AXIS_TVALID held high.
+--               Phase 1 runs with a threshold of 0 (no hits), S_AXIS_TREADY has to
+--               stay high, one signature per clock.
+--               Phase 2 runs with a threshold above every distance, the collector
+--               back-pressures the stream. All results are read back and checked
+--               against distances computed here, together with the performance
+--               counters.
+--               Needs the Vivado FIFO IP cores of the collector, UNISIM and the
+--               raptor_basetypes library, compile it into the hamming_dist library.
+--               xsim, after generating the simulation sources of both FIFO cores
+--               (fifo_cmnclkbram_fwft_wwr64_d32_wrd64_almostfull_almostempty and
+--               fifo_cmnclkbram_fwft_wwr64_d64_wrd128_almostfull_almostempty):
+--                 xvhdl -work raptor_basetypes <pkg_ub_if_types.vhd>
+--                 xvhdl -work hamming_dist <FIFO IP sources> <hamming_dist_element_wrapper_pkg.vhd>
+--                   collector_pkg.vhd fifo_arbiter_rr.vhd collector.vhd hamming_dist_element.vhd
+--                   hamming_dist_element_wrapper.vhd threshold_checker.vhd collector_wrapper.vhd
+--                   hamming_dist_top.vhd tb_hamming_dist_top_stream.vhd
+--                 xelab -L unisims_ver -L unisim -L hamming_dist hamming_dist.tb_hamming_dist_top_stream -s tb_stream
+--                 xsim tb_stream -R
+--               A passing run reports both phases and "tb_hamming_dist_top_stream passed".
+--
+-- Revision History:
+--------------------------------------------------------------------------------
+--
+-- Version | Author                        | Date       | Changes
+-----------+-------------------------------+------------+----------------------------
+-- 1.0     | Martin Kaiser and Sarah Pilz  | 2017-06-30 | - initial release
+-----------+-------------------------------+------------+----------------------------
+
+-----------------
+--  LIBRARIES  --
+-----------------
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+Library UNISIM;
+use UNISIM.vcomponents.all;
+
+--------------
+--  ENTITY  --
+--------------
+
+entity tb_hamming_dist_top_stream is
+end tb_hamming_dist_top_stream;
+
+
+--------------------
+--  ARCHITECTURE  --
+--------------------
+
+architecture SIM of tb_hamming_dist_top_stream is
+
+  ------------------------------
+  --  COMPONENT DECLARATIONS  --
+  ------------------------------
+  component hamming_dist_top is
+    generic(
+      SIGNATURE_LENGTH  : in integer;
+      NUMBER_OF_HAMMING_ELEMENTS : in integer;
+      PIPELINE_STAGES   : in integer;
+      THRESHOLD         : in integer;
+      PORTS_PER_ARBITER : in integer range 2 to 20;
+      C_S_AXI_ID_WIDTH	  : integer	:= 1;
+      C_S_AXI_DATA_WIDTH	: integer	:= 32;
+      C_S_AXI_ADDR_WIDTH	: integer	:= 6;
+      C_S_AXI_AWUSER_WIDTH	: integer	:= 0;
+      C_S_AXI_ARUSER_WIDTH	: integer	:= 0;
+      C_S_AXI_WUSER_WIDTH	: integer	:= 0;
+      C_S_AXI_RUSER_WIDTH	: integer	:= 0;
+      C_S_AXI_BUSER_WIDTH	: integer	:= 0
+    );
+    port(
+      S_AXI_ACLK_IBUF_IN	: in std_logic;
+      S_AXI_ACLK	: in std_logic;
+      S_AXI_ARESETN	: in std_logic;
+      S_AXI_AWID	: in std_logic_vector(C_S_AXI_ID_WIDTH-1 downto 0);
+      S_AXI_AWADDR	  : in std_logic_vector(C_S_AXI_ADDR_WIDTH-1 downto 0);
+      S_AXI_AWLEN	    : in std_logic_vector(7 downto 0);
+      S_AXI_AWSIZE	  : in std_logic_vector(2 downto 0);
+      S_AXI_AWBURST	  : in std_logic_vector(1 downto 0);
+      S_AXI_AWLOCK	  : in std_logic;
+      S_AXI_AWCACHE	  : in std_logic_vector(3 downto 0);
+      S_AXI_AWPROT	  : in std_logic_vector(2 downto 0);
+      S_AXI_AWQOS	    : in std_logic_vector(3 downto 0);
+      S_AXI_AWREGION	: in std_logic_vector(3 downto 0);
+      S_AXI_AWUSER	  : in std_logic_vector(C_S_AXI_AWUSER_WIDTH-1 downto 0);
+      S_AXI_AWVALID	  : in std_logic;
+      S_AXI_AWREADY	  : out std_logic;
+      S_AXI_WDATA	  : in std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+      S_AXI_WSTRB	  : in std_logic_vector((C_S_AXI_DATA_WIDTH/8)-1 downto 0);
+      S_AXI_WLAST	  : in std_logic;
+      S_AXI_WUSER	  : in std_logic_vector(C_S_AXI_WUSER_WIDTH-1 downto 0);
+      S_AXI_WVALID	: in std_logic;
+      S_AXI_WREADY	: out std_logic;
+      S_AXI_BID	    : out std_logic_vector(C_S_AXI_ID_WIDTH-1 downto 0);
+      S_AXI_BRESP	  : out std_logic_vector(1 downto 0);
+      S_AXI_BUSER	  : out std_logic_vector(C_S_AXI_BUSER_WIDTH-1 downto 0);
+      S_AXI_BVALID	: out std_logic;
+      S_AXI_BREADY	: in std_logic;
+      S_AXI_ARID	    : in std_logic_vector(C_S_AXI_ID_WIDTH-1 downto 0);
+      S_AXI_ARADDR	  : in std_logic_vector(C_S_AXI_ADDR_WIDTH-1 downto 0);
+      S_AXI_ARLEN	    : in std_logic_vector(7 downto 0);
+      S_AXI_ARSIZE	  : in std_logic_vector(2 downto 0);
+      S_AXI_ARBURST	  : in std_logic_vector(1 downto 0);
+      S_AXI_ARLOCK	  : in std_logic;
+      S_AXI_ARCACHE	  : in std_logic_vector(3 downto 0);
+      S_AXI_ARPROT	  : in std_logic_vector(2 downto 0);
+      S_AXI_ARQOS	    : in std_logic_vector(3 downto 0);
+      S_AXI_ARREGION	: in std_logic_vector(3 downto 0);
+      S_AXI_ARUSER	  : in std_logic_vector(C_S_AXI_ARUSER_WIDTH-1 downto 0);
+      S_AXI_ARVALID	  : in std_logic;
+      S_AXI_ARREADY	  : out std_logic;
+      S_AXI_RID	      : out std_logic_vector(C_S_AXI_ID_WIDTH-1 downto 0);
+      S_AXI_RDATA	  : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+      S_AXI_RRESP	  : out std_logic_vector(1 downto 0);
+      S_AXI_RLAST	  : out std_logic;
+      S_AXI_RUSER	  : out std_logic_vector(C_S_AXI_RUSER_WIDTH-1 downto 0);
+      S_AXI_RVALID	: out std_logic;
+      S_AXI_RREADY	: in std_logic;
+      S_AXIS_TDATA	: in std_logic_vector(SIGNATURE_LENGTH-1 downto 0);
+      S_AXIS_TVALID	: in std_logic;
+      S_AXIS_TREADY	: out std_logic;
+      S_AXIS_TLAST	: in std_logic
+    );
+  end component hamming_dist_top;
+
+  -----------------
+  --  CONSTANTS  --
+  -----------------
+  constant CLK_PERIOD : time := 5 ns;
+  --small design: 4 HPE and 2 ports per arbiter give 3 collector stages with 4, 2 and 1 fifos
+  constant SIGNATURE_LENGTH : integer := 64;
+  constant NUMBER_OF_HAMMING_ELEMENTS : integer := 4;
+  constant PIPELINE_STAGES : integer := 2;
+  constant PORTS_PER_ARBITER : integer := 2;
+  constant COLLECTOR_STAGES : integer := 3;
+  constant ADDR_WIDTH : integer := 12;
+  constant WORDS_PER_SIGNATURE : integer := SIGNATURE_LENGTH / 32;
+  --register map, see hamming_host.h
+  constant ADDR_SIGNATURE_A : integer := 16#800#;
+  constant ADDR_THRESHOLD : integer := 16#200#;
+  constant ADDR_RESULTS : integer := 16#100#;
+  constant ADDR_COUNTERS : integer := 16#400#;
+  constant PERF_COUNTERS : integer := 6 + COLLECTOR_STAGES;
+  constant PERF_COMPARISONS : integer := 2;
+  constant PERF_HITS : integer := 3;
+  constant PERF_STREAM : integer := 5;
+  --phase 1 without hits, phase 2 with a hit for every pair. The results of phase 2 fit into the
+  --collector (4 x 24 + 2 x 32 + 64 words), so they are read after the stream
+  constant ZERO_HIT_BEATS : integer := 200;
+  constant HIT_BEATS : integer := 48;
+  constant RESULTS : integer := NUMBER_OF_HAMMING_ELEMENTS * HIT_BEATS;
+  --16 words of 128 bit per burst, the read address stays in the result range
+  constant RESULT_WORDS_PER_BURST : integer := 16;
+  constant SALT_A : unsigned(63 downto 0) := x"9E3779B97F4A7C15";
+  constant SALT_B : unsigned(63 downto 0) := x"D1B54A32D192ED03";
+
+  -------------
+  --  TYPES  --
+  -------------
+  type word_array is array (natural range <>) of std_logic_vector(31 downto 0);
+  type bool_array is array (natural range <>) of boolean;
+
+  ---------------------------
+  --  SIGNAL DECLARATIONS  --
+  ---------------------------
+  signal clk_ibuf : std_logic := '0';
+  signal aclk : std_logic;
+  signal sim_done : std_logic := '0';
+  signal aresetn : std_logic := '0';
+  --S_AXI master
+  signal s_axi_awaddr : std_logic_vector(ADDR_WIDTH-1 downto 0) := (others => '0');
+  signal s_axi_awlen : std_logic_vector(7 downto 0) := (others => '0');
+  signal s_axi_awvalid : std_logic := '0';
+  signal s_axi_awready : std_logic;
+  signal s_axi_wdata : std_logic_vector(31 downto 0) := (others => '0');
+  signal s_axi_wlast : std_logic := '0';
+  signal s_axi_wvalid : std_logic := '0';
+  signal s_axi_wready : std_logic;
+  signal s_axi_bvalid : std_logic;
+  signal s_axi_bready : std_logic := '0';
+  signal s_axi_araddr : std_logic_vector(ADDR_WIDTH-1 downto 0) := (others => '0');
+  signal s_axi_arlen : std_logic_vector(7 downto 0) := (others => '0');
+  signal s_axi_arvalid : std_logic := '0';
+  signal s_axi_arready : std_logic;
+  signal s_axi_rdata : std_logic_vector(31 downto 0);
+  signal s_axi_rlast : std_logic;
+  signal s_axi_rvalid : std_logic;
+  signal s_axi_rready : std_logic := '0';
+  signal s_axi_null : std_logic_vector(-1 downto 0);
+  --S_AXIS master
+  signal s_axis_tdata : std_logic_vector(SIGNATURE_LENGTH-1 downto 0) := (others => '0');
+  signal s_axis_tvalid : std_logic := '0';
+  signal s_axis_tready : std_logic;
+  --stream control, signatures B stream_first to stream_end-1 are sent while stream_go is set
+  signal stream_go : std_logic := '0';
+  signal stream_done : std_logic := '0';
+  signal stream_first : natural := 0;
+  signal stream_end : natural := 0;
+  signal stream_waits : natural := 0;
+
+  -------------------
+  -----Functions-----
+  -------------------
+  --signature n of a set, xorshift64 seeded with n, the same values in the stream and in the checks
+  function make_signature(n : natural; salt : unsigned(63 downto 0)) return unsigned is
+  variable x : unsigned(63 downto 0);
+  variable s : unsigned(SIGNATURE_LENGTH-1 downto 0);
+  begin
+    x := to_unsigned(n, 64) xor salt;
+    for c in 0 to SIGNATURE_LENGTH/64-1 loop
+      for r in 0 to 3 loop
+        x := x xor shift_left(x, 13);
+        x := x xor shift_right(x, 7);
+        x := x xor shift_left(x, 17);
+      end loop;
+      s(64*c+63 downto 64*c) := x;
+    end loop;
+  return s;
+  end make_signature;
+
+  function COUNT_ONES (VALUES : unsigned) return integer is
+  variable CNT : integer := 0;
+  begin
+    for i in VALUES'range loop
+      if (VALUES(i) = '1') then
+        CNT := CNT + 1;
+      end if;
+    end loop;
+  return CNT;
+  end COUNT_ONES;
+
+---------
+begin  --
+---------
+
+  -------------------------------
+  --  COMPONENT INSTANTIAIONS  --
+  -------------------------------
+  --the gated HPE clock comes from a BUFGCE, the same buffer on the bus clock keeps both clocks in the same delta cycle
+  aclk_bufg_inst : BUFGCE
+  port map (
+    O => aclk,
+    CE => '1',
+    I => clk_ibuf
+  );
+
+  dut : hamming_dist_top
+  generic map(
+    SIGNATURE_LENGTH            => SIGNATURE_LENGTH,
+    NUMBER_OF_HAMMING_ELEMENTS  => NUMBER_OF_HAMMING_ELEMENTS,
+    PIPELINE_STAGES             => PIPELINE_STAGES,
+    THRESHOLD                   => 200,
+    PORTS_PER_ARBITER           => PORTS_PER_ARBITER,
+    C_S_AXI_ADDR_WIDTH          => ADDR_WIDTH
+  )
+  port map(
+    S_AXI_ACLK_IBUF_IN  => clk_ibuf,
+    S_AXI_ACLK          => aclk,
+    S_AXI_ARESETN       => aresetn,
+    S_AXI_AWID          => "0",
+    S_AXI_AWADDR        => s_axi_awaddr,
+    S_AXI_AWLEN         => s_axi_awlen,
+    S_AXI_AWSIZE        => "010",
+    S_AXI_AWBURST       => "01",
+    S_AXI_AWLOCK        => '0',
+    S_AXI_AWCACHE       => "0000",
+    S_AXI_AWPROT        => "000",
+    S_AXI_AWQOS         => "0000",
+    S_AXI_AWREGION      => "0000",
+    S_AXI_AWUSER        => s_axi_null,
+    S_AXI_AWVALID       => s_axi_awvalid,
+    S_AXI_AWREADY       => s_axi_awready,
+    S_AXI_WDATA         => s_axi_wdata,
+    S_AXI_WSTRB         => "1111",
+    S_AXI_WLAST         => s_axi_wlast,
+    S_AXI_WUSER         => s_axi_null,
+    S_AXI_WVALID        => s_axi_wvalid,
+    S_AXI_WREADY        => s_axi_wready,
+    S_AXI_BID           => open,
+    S_AXI_BRESP         => open,
+    S_AXI_BUSER         => open,
+    S_AXI_BVALID        => s_axi_bvalid,
+    S_AXI_BREADY        => s_axi_bready,
+    S_AXI_ARID          => "0",
+    S_AXI_ARADDR        => s_axi_araddr,
+    S_AXI_ARLEN         => s_axi_arlen,
+    S_AXI_ARSIZE        => "010",
+    S_AXI_ARBURST       => "01",
+    S_AXI_ARLOCK        => '0',
+    S_AXI_ARCACHE       => "0000",
+    S_AXI_ARPROT        => "000",
+    S_AXI_ARQOS         => "0000",
+    S_AXI_ARREGION      => "0000",
+    S_AXI_ARUSER        => s_axi_null,
+    S_AXI_ARVALID       => s_axi_arvalid,
+    S_AXI_ARREADY       => s_axi_arready,
+    S_AXI_RID           => open,
+    S_AXI_RDATA         => s_axi_rdata,
+    S_AXI_RRESP         => open,
+    S_AXI_RLAST         => s_axi_rlast,
+    S_AXI_RUSER         => open,
+    S_AXI_RVALID        => s_axi_rvalid,
+    S_AXI_RREADY        => s_axi_rready,
+    S_AXIS_TDATA        => s_axis_tdata,
+    S_AXIS_TVALID       => s_axis_tvalid,
+    S_AXIS_TREADY       => s_axis_tready,
+    S_AXIS_TLAST        => '0'
+  );
+
+  -----------------
+  --  PROCESSES  --
+  -----------------
+  clk_p : process
+  begin
+    while (sim_done = '0') loop
+      clk_ibuf <= '0';
+      wait for CLK_PERIOD / 2;
+      clk_ibuf <= '1';
+      wait for CLK_PERIOD / 2;
+    end loop;
+    wait;
+  end process clk_p;
+
+  --S_AXIS master, TVALID stays high until all signatures of a run are taken
+  stream_p : process
+  variable idx : natural;
+  variable waits : natural;
+  begin
+    loop
+      wait until stream_go = '1';
+      idx := stream_first;
+      waits := 0;
+      s_axis_tdata <= std_logic_vector(make_signature(idx, SALT_B));
+      s_axis_tvalid <= '1';
+      while (idx < stream_end) loop
+        wait until rising_edge(aclk);
+        if (s_axis_tready = '1') then
+          idx := idx + 1;
+          if (idx < stream_end) then
+            s_axis_tdata <= std_logic_vector(make_signature(idx, SALT_B));
+          else
+            s_axis_tvalid <= '0';
+          end if;
+        else
+          waits := waits + 1;
+        end if;
+      end loop;
+      stream_waits <= waits;
+      stream_done <= '1';
+      wait until stream_go = '0';
+      stream_done <= '0';
+    end loop;
+  end process stream_p;
+
+  main_p : process
+  variable sig_words : word_array(0 to NUMBER_OF_HAMMING_ELEMENTS*WORDS_PER_SIGNATURE-1);
+  variable counters : word_array(0 to 2+2*PERF_COUNTERS-1);
+  variable beats : word_array(0 to 4*RESULT_WORDS_PER_BURST-1);
+  variable seen : bool_array(0 to RESULTS-1) := (others => false);
+  variable errors : natural := 0;
+
+    --Write burst. The software FSM leaves IDLE one clock after the address handshake, the first data
+    --beat is offered with that clock so it is not taken in IDLE. BREADY is only set with the last beat,
+    --WRITE_SIG_A/B return to IDLE on BREADY.
+    procedure axi_write(addr : in natural; words : in word_array) is
+    begin
+      s_axi_awaddr <= std_logic_vector(to_unsigned(addr, ADDR_WIDTH));
+      s_axi_awlen <= std_logic_vector(to_unsigned(words'length-1, 8));
+      s_axi_awvalid <= '1';
+      wait until rising_edge(aclk);
+      s_axi_wdata <= words(words'low);
+      s_axi_wvalid <= '1';
+      if (words'length = 1) then
+        s_axi_wlast <= '1';
+        s_axi_bready <= '1';
+      end if;
+      wait until rising_edge(aclk) and s_axi_awready = '1';
+      s_axi_awvalid <= '0';
+      for i in words'range loop
+        wait until rising_edge(aclk) and s_axi_wready = '1';
+        if (i = words'high) then
+          s_axi_wvalid <= '0';
+          s_axi_wlast <= '0';
+        else
+          s_axi_wdata <= words(i+1);
+          if (i+1 = words'high) then
+            s_axi_wlast <= '1';
+            s_axi_bready <= '1';
+          end if;
+        end if;
+      end loop;
+      --a single beat has its response with the data handshake
+      if (s_axi_bvalid /= '1') then
+        wait until rising_edge(aclk) and s_axi_bvalid = '1';
+      end if;
+      s_axi_bready <= '0';
+      wait until rising_edge(aclk);
+    end procedure axi_write;
+
+    --Read burst. The first clock of RVALID shows the data of the state before (READ_FIFO_OUTPUT
+    --loads the result word with it), so every beat is taken in the second clock of RVALID.
+    procedure axi_read(addr : in natural; words : out word_array) is
+    begin
+      s_axi_araddr <= std_logic_vector(to_unsigned(addr, ADDR_WIDTH));
+      s_axi_arlen <= std_logic_vector(to_unsigned(words'length-1, 8));
+      s_axi_arvalid <= '1';
+      wait until rising_edge(aclk) and s_axi_arready = '1';
+      s_axi_arvalid <= '0';
+      for i in words'range loop
+        wait until rising_edge(aclk) and s_axi_rvalid = '1';
+        s_axi_rready <= '1';
+        wait until rising_edge(aclk) and s_axi_rvalid = '1';
+        words(i) := s_axi_rdata;
+        s_axi_rready <= '0';
+      end loop;
+      wait until rising_edge(aclk);
+    end procedure axi_read;
+
+    procedure write_threshold(value : in natural) is
+    variable word : word_array(0 to 0);
+    begin
+      word(0) := std_logic_vector(to_unsigned(value, 32));
+      axi_write(ADDR_THRESHOLD, word);
+    end procedure write_threshold;
+
+    --all signatures A in one burst, upper word first. The first signature ends up in the last HPE.
+    procedure write_signatures_A is
+    variable sig : unsigned(SIGNATURE_LENGTH-1 downto 0);
+    begin
+      for p in 0 to NUMBER_OF_HAMMING_ELEMENTS-1 loop
+        sig := make_signature(p, SALT_A);
+        for w in 0 to WORDS_PER_SIGNATURE-1 loop
+          sig_words(p*WORDS_PER_SIGNATURE+w) := std_logic_vector(sig(SIGNATURE_LENGTH-1-32*w downto SIGNATURE_LENGTH-32-32*w));
+        end loop;
+      end loop;
+      axi_write(ADDR_SIGNATURE_A, sig_words);
+    end procedure write_signatures_A;
+
+    procedure stream(first : in natural; count : in natural) is
+    begin
+      stream_first <= first;
+      stream_end <= first + count;
+      stream_go <= '1';
+      wait until stream_done = '1';
+      stream_go <= '0';
+      wait until rising_edge(aclk);
+    end procedure stream;
+
+    procedure check_counter(name : in string; idx : in natural; expected : in natural) is
+    variable value : unsigned(63 downto 0);
+    begin
+      value := unsigned(counters(2+2*idx+1)) & unsigned(counters(2+2*idx));
+      if (value /= to_unsigned(expected, 64)) then
+        report name & " counter is " & integer'image(to_integer(value(30 downto 0))) & ", expected " & integer'image(expected) severity error;
+        errors := errors + 1;
+      end if;
+    end procedure check_counter;
+
+    procedure check_result(r : in std_logic_vector(63 downto 0)) is
+    variable dist : natural;
+    variable idx_b : natural;
+    variable hpe : natural;
+    variable b : integer;
+    variable expected : natural;
+    begin
+      dist := to_integer(unsigned(r(9 downto 0)));
+      idx_b := to_integer(unsigned(r(36 downto 10)));
+      hpe := to_integer(unsigned(r(63 downto 37)));
+      b := idx_b - ZERO_HIT_BEATS;
+      if (hpe >= NUMBER_OF_HAMMING_ELEMENTS or b < 0 or b >= HIT_BEATS) then
+        report "Result with HPE " & integer'image(hpe) & " and signature B " & integer'image(idx_b) & " out of range" severity error;
+        errors := errors + 1;
+        return;
+      end if;
+      expected := COUNT_ONES(make_signature(NUMBER_OF_HAMMING_ELEMENTS-1-hpe, SALT_A) xor make_signature(idx_b, SALT_B));
+      if (dist /= expected) then
+        report "Distance " & integer'image(dist) & " of HPE " & integer'image(hpe) & " and signature B " & integer'image(idx_b) & ", expected " & integer'image(expected) severity error;
+        errors := errors + 1;
+      end if;
+      if (seen(b*NUMBER_OF_HAMMING_ELEMENTS+hpe)) then
+        report "Duplicate result of HPE " & integer'image(hpe) & " and signature B " & integer'image(idx_b) severity error;
+        errors := errors + 1;
+      end if;
+      seen(b*NUMBER_OF_HAMMING_ELEMENTS+hpe) := true;
+    end procedure check_result;
+
+  begin
+    aresetn <= '0';
+    for i in 0 to 15 loop
+      wait until rising_edge(aclk);
+    end loop;
+    aresetn <= '1';
+    for i in 0 to 15 loop
+      wait until rising_edge(aclk);
+    end loop;
+
+    --phase 1: no hits, the stream must not be stopped
+    write_threshold(0);
+    write_signatures_A;
+    stream(0, ZERO_HIT_BEATS);
+    if (stream_waits /= 0) then
+      report "S_AXIS_TREADY low for " & integer'image(stream_waits) & " clocks without hits" severity error;
+      errors := errors + 1;
+    else
+      report "Phase 1: " & integer'image(ZERO_HIT_BEATS) & " signatures B in " & integer'image(ZERO_HIT_BEATS) & " clocks" severity note;
+    end if;
+    for i in 0 to 63 loop
+      wait until rising_edge(aclk);
+    end loop;
+    axi_read(ADDR_COUNTERS, counters);
+    check_counter("Stream", PERF_STREAM, ZERO_HIT_BEATS);
+    check_counter("Comparison", PERF_COMPARISONS, NUMBER_OF_HAMMING_ELEMENTS * ZERO_HIT_BEATS);
+    check_counter("Hit", PERF_HITS, 0);
+
+    --phase 2: every pair is a hit, the threshold is taken over with the signatures A
+    write_threshold(1023);
+    write_signatures_A;
+    stream(ZERO_HIT_BEATS, HIT_BEATS);
+    report "Phase 2: " & integer'image(HIT_BEATS) & " signatures B, S_AXIS_TREADY low for " & integer'image(stream_waits) & " clocks" severity note;
+    for i in 0 to 1023 loop
+      wait until rising_edge(aclk);
+    end loop;
+    axi_read(ADDR_COUNTERS, counters);
+    check_counter("Stream", PERF_STREAM, ZERO_HIT_BEATS + HIT_BEATS);
+    check_counter("Comparison", PERF_COMPARISONS, NUMBER_OF_HAMMING_ELEMENTS * (ZERO_HIT_BEATS + HIT_BEATS));
+    check_counter("Hit", PERF_HITS, RESULTS);
+
+    --two results per 128 bit word, lower 32 bits first
+    for burst in 0 to RESULTS / (2 * RESULT_WORDS_PER_BURST) - 1 loop
+      axi_read(ADDR_RESULTS, beats);
+      for w in 0 to RESULT_WORDS_PER_BURST-1 loop
+        check_result(beats(4*w+1) & beats(4*w));
+        check_result(beats(4*w+3) & beats(4*w+2));
+      end loop;
+    end loop;
+
+    for i in seen'range loop
+      if (not seen(i)) then
+        report "Missing result of HPE " & integer'image(i mod NUMBER_OF_HAMMING_ELEMENTS) & " and signature B " & integer'image(ZERO_HIT_BEATS + i / NUMBER_OF_HAMMING_ELEMENTS) severity error;
+        errors := errors + 1;
+      end if;
+    end loop;
+
+    if (errors = 0) then
+      report "tb_hamming_dist_top_stream passed" severity note;
+    else
+      report "tb_hamming_dist_top_stream failed with " & integer'image(errors) & " errors" severity failure;
+    end if;
+    sim_done <= '1';
+    wait;
+  end process main_p;
+
+end SIM;
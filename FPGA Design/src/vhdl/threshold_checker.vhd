@@ -24,8 +24,10 @@
 --
 -- File Name   : threshold_checker.vhd
 -- Author      : Martin Kaiser and Sarah Pilz
--- Description : Takes an input value and compares it to a generic threshold value
---               values lower than the threshold will be given back
+-- Description : Takes an input value and compares it to a threshold value
+--               values lower than the threshold will be given back.
+--               The threshold is latched from THRESHOLD_IN with every
+--               THRESHOLD_LATCH_IN, the generic is the value after reset
 --
 -- Revision History:
 --------------------------------------------------------------------------------
@@ -55,11 +57,13 @@ use hamming_dist.hamming_dist_element_wrapper_pkg.all;
 entity threshold_checker is
   generic(
     NUMBER_OF_HAMMING_ELEMENTS : in integer;
-    THRESHOLD                  : in integer --only results below this threshold will be forwarded
+    THRESHOLD                  : in integer --threshold after reset, only results below the threshold will be forwarded
   );
   port(
     CLK_IN                  : in  std_logic;
     RESET_N_IN              : in  std_logic;
+    THRESHOLD_IN            : in  unsigned(9 downto 0);                                                 --Threshold of the next job
+    THRESHOLD_LATCH_IN      : in  std_logic;                                                            --Takes over THRESHOLD_IN
     HPE_RESULTS_IN          : in  array_pefifo_inoutputs_genlength(0 to NUMBER_OF_HAMMING_ELEMENTS-1);  --Result value input
     HPE_RESULTS_WR_REQ_IN   : in  unsigned(NUMBER_OF_HAMMING_ELEMENTS-1 downto 0);                      --Write request / enable
     HPE_RESULTS_OUT         : out  array_pefifo_inoutputs_genlength(0 to NUMBER_OF_HAMMING_ELEMENTS-1); --Result value output
@@ -78,6 +82,7 @@ architecture RTL of threshold_checker is
 --  SIGNAL DECLARATIONS  --
 ---------------------------
 signal result_debug : std_logic_vector(9 downto 0); --debug signal for simulation usage only
+signal current_threshold : unsigned(9 downto 0) := to_unsigned(THRESHOLD, 10);
 
 ---------
 begin  --
@@ -88,12 +93,18 @@ process (CLK_IN)
 	  if rising_edge(CLK_IN) then
 	    if RESET_N_IN = '0' then
             HPE_RESULTS_WR_REQ_OUT <= (others => '0');
+            current_threshold <= to_unsigned(THRESHOLD, current_threshold'length);
       else
+         --a job starts with its signatures A, results of the job before have left the HPE by then
+         if (THRESHOLD_LATCH_IN = '1') then
+            current_threshold <= THRESHOLD_IN;
+         end if;
+
          for i in 0 to NUMBER_OF_HAMMING_ELEMENTS-1 loop
             HPE_RESULTS_OUT(i) <= HPE_RESULTS_IN(i);
-            result_debug <= std_logic_vector(to_unsigned(THRESHOLD, HPE_RESULTS_IN(i)(9 downto 0)'length));
+            result_debug <= std_logic_vector(current_threshold);
             --forward the write request if result value is below the threshold
-          if (HPE_RESULTS_IN(i) (9 downto 0) < std_logic_vector(to_unsigned(THRESHOLD, HPE_RESULTS_IN(i)(9 downto 0)'length))) then       
+          if (HPE_RESULTS_IN(i) (9 downto 0) < std_logic_vector(current_threshold)) then       
             HPE_RESULTS_WR_REQ_OUT(i) <= HPE_RESULTS_WR_REQ_IN(i);
           else
             HPE_RESULTS_WR_REQ_OUT(i) <= '0';   
@@ -0,0 +1,84 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+/* Minimal allocator for std::vector that aligns the storage to ALIGN
+ * bytes (e.g. a cache line)
+ * */
+template <typename T, size_t ALIGN>
+struct AlignedAllocator
+{
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, ALIGN> other;
+	};
+
+	AlignedAllocator() {}
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, ALIGN>&) {}
+
+	T* allocate(size_t n)
+	{
+		// Round up to a multiple of ALIGN so the block ends on a boundary as well
+		const size_t size = (n * sizeof(T) + ALIGN - 1) & ~(ALIGN - 1);
+#ifdef _WIN32
+		void* p = _aligned_malloc(size, ALIGN);
+#else
+		void* p = nullptr;
+		if (posix_memalign(&p, ALIGN, size) != 0)
+			p = nullptr;
+#endif
+		if (p == nullptr)
+			throw std::bad_alloc();
+
+		return (T*)p;
+	}
+
+	void deallocate(T* p, size_t)
+	{
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		free(p);
+#endif
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, ALIGN>&) const { return true; }
+
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, ALIGN>&) const { return false; }
+};
@@ -0,0 +1,168 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "HammingKernels.h"
+
+/* Vectorized popcount after Mula et al., "Faster Population Counts Using
+ * AVX2 Instructions". Each byte is split into two nibbles that are counted
+ * with a PSHUFB lookup, _mm256_sad_epu8 sums the byte counts into four
+ * 64 bit lanes. Nothing leaves the vector registers until the final sum.
+ * */
+
+static inline __m256i popcountBytes(__m256i v)
+{
+	const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+	                                     0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i lowMask = _mm256_set1_epi8(0x0F);
+
+	const __m256i lo = _mm256_and_si256(v, lowMask);
+	const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+
+	return _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+}
+
+// Popcount of both halves of a 512 bit XOR, one 64 bit partial sum per lane
+static inline __m256i popcount512Lanes(__m256i lo, __m256i hi)
+{
+	// Byte counts are <= 8 per half, so adding them before the SAD can not overflow
+	return _mm256_sad_epu8(_mm256_add_epi8(popcountBytes(lo), popcountBytes(hi)), _mm256_setzero_si256());
+}
+
+static inline uint64_t hsum256(__m256i v)
+{
+	const __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	return (uint64_t)_mm_cvtsi128_si64(s) + (uint64_t)_mm_extract_epi64(s, 1);
+}
+
+uint32_t hamming512Lut(const hash& a, const hash& b)
+{
+	const __m256i lo = _mm256_xor_si256(a.vals.octaWords[0].value, b.vals.octaWords[0].value);
+	const __m256i hi = _mm256_xor_si256(a.vals.octaWords[1].value, b.vals.octaWords[1].value);
+
+	return (uint32_t)hsum256(popcount512Lanes(lo, hi));
+}
+
+void hammingBlockLut(const hash* pStatic, uint32_t rows, const hash* pDyn, uint32_t count, uint16_t* pDist)
+{
+	__m256i sLo[AVX2_ROWS];
+	__m256i sHi[AVX2_ROWS];
+
+	// Missing rows of a tail block are compared against zero and ignored
+	for (uint32_t r = 0; r < AVX2_ROWS; r++)
+	{
+		sLo[r] = r < rows ? pStatic[r].vals.octaWords[0].value : _mm256_setzero_si256();
+		sHi[r] = r < rows ? pStatic[r].vals.octaWords[1].value : _mm256_setzero_si256();
+	}
+
+	// Gathers the low dword of every 64 bit lane into the lower half
+	const __m256i packIdx = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+	for (uint32_t j = 0; j < count; j++)
+	{
+		const __m256i dLo = pDyn[j].vals.octaWords[0].value;
+		const __m256i dHi = pDyn[j].vals.octaWords[1].value;
+
+		__m256i p[AVX2_ROWS];
+
+		for (uint32_t r = 0; r < AVX2_ROWS; r++)
+			p[r] = popcount512Lanes(_mm256_xor_si256(sLo[r], dLo), _mm256_xor_si256(sHi[r], dHi));
+
+		// Transpose and add, lane r of the result is the distance to row r
+		const __m256i t0 = _mm256_add_epi64(_mm256_unpacklo_epi64(p[0], p[1]), _mm256_unpackhi_epi64(p[0], p[1]));
+		const __m256i t1 = _mm256_add_epi64(_mm256_unpacklo_epi64(p[2], p[3]), _mm256_unpackhi_epi64(p[2], p[3]));
+		const __m256i d = _mm256_add_epi64(_mm256_permute2x128_si256(t0, t1, 0x20), _mm256_permute2x128_si256(t0, t1, 0x31));
+
+		const __m128i d32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(d, packIdx));
+		_mm_storel_epi64((__m128i*)&pDist[j * AVX2_ROWS], _mm_packus_epi32(d32, d32));
+	}
+}
+
+// Carry-save adder, h:l = a + b + c
+static inline void csa(__m256i& h, __m256i& l, __m256i a, __m256i b, __m256i c)
+{
+	const __m256i u = _mm256_xor_si256(a, b);
+	h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+	l = _mm256_xor_si256(u, c);
+}
+
+static inline __m256i popcount256Lanes(__m256i v)
+{
+	return _mm256_sad_epu8(popcountBytes(v), _mm256_setzero_si256());
+}
+
+uint64_t hammingSumHarleySeal(const hash& s, const hash* pDyn, uint32_t count)
+{
+	const __m256i sLo = s.vals.octaWords[0].value;
+	const __m256i sHi = s.vals.octaWords[1].value;
+
+	__m256i total = _mm256_setzero_si256();
+	__m256i ones = _mm256_setzero_si256();
+	__m256i twos = _mm256_setzero_si256();
+	__m256i fours = _mm256_setzero_si256();
+	__m256i eights = _mm256_setzero_si256();
+	__m256i twosA, twosB, foursA, foursB, eightsA, eightsB, sixteens;
+
+	uint32_t j = 0;
+
+	// 8 dynamic hashes = 16 vectors per step, only the sixteens are counted
+	for (; j + 8 <= count; j += 8)
+	{
+		const hash* d = &pDyn[j];
+
+#define HS_LO(k) _mm256_xor_si256(sLo, d[k].vals.octaWords[0].value)
+#define HS_HI(k) _mm256_xor_si256(sHi, d[k].vals.octaWords[1].value)
+
+		csa(twosA, ones, ones, HS_LO(0), HS_HI(0));
+		csa(twosB, ones, ones, HS_LO(1), HS_HI(1));
+		csa(foursA, twos, twos, twosA, twosB);
+		csa(twosA, ones, ones, HS_LO(2), HS_HI(2));
+		csa(twosB, ones, ones, HS_LO(3), HS_HI(3));
+		csa(foursB, twos, twos, twosA, twosB);
+		csa(eightsA, fours, fours, foursA, foursB);
+		csa(twosA, ones, ones, HS_LO(4), HS_HI(4));
+		csa(twosB, ones, ones, HS_LO(5), HS_HI(5));
+		csa(foursA, twos, twos, twosA, twosB);
+		csa(twosA, ones, ones, HS_LO(6), HS_HI(6));
+		csa(twosB, ones, ones, HS_LO(7), HS_HI(7));
+		csa(foursB, twos, twos, twosA, twosB);
+		csa(eightsB, fours, fours, foursA, foursB);
+		csa(sixteens, eights, eights, eightsA, eightsB);
+
+#undef HS_LO
+#undef HS_HI
+
+		total = _mm256_add_epi64(total, popcount256Lanes(sixteens));
+	}
+
+	total = _mm256_slli_epi64(total, 4);
+	total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256Lanes(eights), 3));
+	total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256Lanes(fours), 2));
+	total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256Lanes(twos), 1));
+	total = _mm256_add_epi64(total, popcount256Lanes(ones));
+
+	for (; j < count; j++)
+		total = _mm256_add_epi64(total, popcount512Lanes(_mm256_xor_si256(sLo, pDyn[j].vals.octaWords[0].value), _mm256_xor_si256(sHi, pDyn[j].vals.octaWords[1].value)));
+
+	return hsum256(total);
+}
@@ -0,0 +1,73 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "HammingKernels.h"
+#include "CpuFeatures.h"
+
+#include <immintrin.h>
+
+TARGET_AVX512 uint32_t hamming512Avx512(const hash& a, const hash& b)
+{
+	const __m512i v = _mm512_xor_si512(_mm512_loadu_si512(a.vals.bytes), _mm512_loadu_si512(b.vals.bytes));
+	return (uint32_t)_mm512_reduce_add_epi64(_mm512_popcnt_epi64(v));
+}
+
+/* Horizontal sum of eight vectors, lane r of the result holds the sum of
+ * all lanes of p[r]
+ * */
+TARGET_AVX512 static inline __m512i reduceRows(const __m512i p[AVX512_ROWS])
+{
+	// Pairwise sums within 128 bit lanes, t[k] = (p[2k], p[2k+1]) per 128 bit lane
+	__m512i t[4];
+
+	for (int k = 0; k < 4; k++)
+		t[k] = _mm512_add_epi64(_mm512_unpacklo_epi64(p[2 * k], p[2 * k + 1]), _mm512_unpackhi_epi64(p[2 * k], p[2 * k + 1]));
+
+	// Fold 128 bit lanes (0,1) and (2,3) of two vectors into one
+	const __m512i u0 = _mm512_add_epi64(_mm512_shuffle_i64x2(t[0], t[1], 0x88), _mm512_shuffle_i64x2(t[0], t[1], 0xDD));
+	const __m512i u1 = _mm512_add_epi64(_mm512_shuffle_i64x2(t[2], t[3], 0x88), _mm512_shuffle_i64x2(t[2], t[3], 0xDD));
+
+	return _mm512_add_epi64(_mm512_shuffle_i64x2(u0, u1, 0x88), _mm512_shuffle_i64x2(u0, u1, 0xDD));
+}
+
+TARGET_AVX512 void hammingBlockAvx512(const hash* pStatic, uint32_t rows, const hash* pDyn, uint32_t count, uint16_t* pDist)
+{
+	// One zmm register per static hash, missing rows of a tail block are
+	// compared against zero and ignored by the caller
+	__m512i s[AVX512_ROWS];
+
+	for (uint32_t r = 0; r < AVX512_ROWS; r++)
+		s[r] = r < rows ? _mm512_loadu_si512(pStatic[r].vals.bytes) : _mm512_setzero_si512();
+
+	for (uint32_t j = 0; j < count; j++)
+	{
+		const __m512i d = _mm512_loadu_si512(pDyn[j].vals.bytes);
+		__m512i p[AVX512_ROWS];
+
+		for (uint32_t r = 0; r < AVX512_ROWS; r++)
+			p[r] = _mm512_popcnt_epi64(_mm512_xor_si512(s[r], d));
+
+		_mm_storeu_si128((__m128i*)&pDist[j * AVX512_ROWS], _mm512_cvtepi64_epi16(reduceRows(p)));
+	}
+}
@@ -0,0 +1,88 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "CpuFeatures.h"
+
+#include <stdint.h>
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static void cpuid(uint32_t leaf, uint32_t subLeaf, uint32_t regs[4])
+{
+#ifdef _WIN32
+	__cpuidex((int*)regs, leaf, subLeaf);
+#else
+	__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv0()
+{
+#ifdef _WIN32
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static CpuFeatures detectCpuFeatures()
+{
+	CpuFeatures f = { false, false, false, false };
+	uint32_t regs[4];
+
+	cpuid(0, 0, regs);
+	const uint32_t maxLeaf = regs[0];
+
+	if (maxLeaf < 1)
+		return f;
+
+	cpuid(1, 0, regs);
+	f.popcnt = (regs[2] >> 23) & 1;
+	const bool osxsave = (regs[2] >> 27) & 1;
+
+	if (!osxsave || maxLeaf < 7)
+		return f;
+
+	const uint64_t xcr0 = xgetbv0();
+	const bool osAvx = (xcr0 & 0x06) == 0x06;    // XMM and YMM state
+	const bool osAvx512 = (xcr0 & 0xE6) == 0xE6; // Additionally opmask and ZMM state
+
+	cpuid(7, 0, regs);
+	f.avx2 = osAvx && ((regs[1] >> 5) & 1);
+	f.avx512f = osAvx512 && ((regs[1] >> 16) & 1);
+	f.avx512vpopcntdq = f.avx512f && ((regs[2] >> 14) & 1);
+
+	return f;
+}
+
+const CpuFeatures& cpuFeatures()
+{
+	static const CpuFeatures features = detectCpuFeatures();
+	return features;
+}
@@ -0,0 +1,47 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+struct CpuFeatures
+{
+	bool popcnt;
+	bool avx2;
+	bool avx512f;
+	bool avx512vpopcntdq;
+};
+
+/* Query the host CPU via cpuid, vector extensions are only reported if
+ * the OS also saves the corresponding register state (xgetbv).
+ * The result is cached after the first call.
+ * */
+const CpuFeatures& cpuFeatures();
+
+// Enables AVX-512 code generation for a single function, MSVC does not
+// need this as long as the intrinsics are available
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512vpopcntdq")))
+#else
+#define TARGET_AVX512
+#endif
@@ -0,0 +1,70 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "EarlyAbortSearch.h"
+
+void earlyAbortSearch(const hash* pStatic, size_t staticSize, const hash* pDyn, size_t dynSize, uint32_t threshold, const TileShape& shape, ThresholdSink& sink, PruneStats& stats)
+{
+	const int tiles = (int)((dynSize + shape.dynTile - 1) / shape.dynTile);
+
+	uint64_t pairs = 0;
+	uint64_t pruned128 = 0;
+	uint64_t pruned256 = 0;
+
+#pragma omp parallel reduction(+:pairs, pruned128, pruned256)
+	{
+#ifdef _OPENMP
+		const int tid = omp_get_thread_num();
+#else
+		const int tid = 0;
+#endif
+		PruneStats local = { 0, 0, 0 };
+
+#pragma omp for schedule(dynamic)
+		for (int t = 0; t < tiles; t++)
+		{
+			const size_t d = (size_t)t * shape.dynTile;
+			const size_t dEnd = std::min(d + shape.dynTile, dynSize);
+
+			for (size_t i = 0; i < staticSize; i++)
+			{
+				for (size_t j = d; j < dEnd; j++)
+				{
+					const uint32_t dist = hamming512EarlyAbort(pStatic[i], pDyn[j], threshold, local);
+
+					if (dist < threshold)
+						sink.add(tid, Result::Pack(dist, j, i));
+				}
+			}
+		}
+
+		pairs += local.pairs;
+		pruned128 += local.pruned128;
+		pruned256 += local.pruned256;
+	}
+
+	stats.pairs = pairs;
+	stats.pruned128 = pruned128;
+	stats.pruned256 = pruned256;
+}
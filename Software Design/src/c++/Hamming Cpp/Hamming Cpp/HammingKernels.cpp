@@ -0,0 +1,131 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "HammingKernels.h"
+#include "CpuFeatures.h"
+
+#include <string.h>
+
+uint32_t hamming512Scalar(const hash& a, const hash& b)
+{
+	return popCnt512(a ^ b);
+}
+
+void hammingBlockScalar(const hash* pStatic, uint32_t rows, const hash* pDyn, uint32_t count, uint16_t* pDist)
+{
+	for (uint32_t j = 0; j < count; j++)
+		for (uint32_t r = 0; r < rows; r++)
+			pDist[j * SCALAR_ROWS + r] = (uint16_t)hamming512Scalar(pStatic[r], pDyn[j]);
+}
+
+template <uint32_t ROWS>
+static void hammingBlockAvx2Rows(const hash* pStatic, const hash* pDyn, uint32_t count, uint16_t* pDist)
+{
+	// Keep the static block in registers for the whole dynamic tile
+	__m256i sLo[ROWS];
+	__m256i sHi[ROWS];
+
+	for (uint32_t r = 0; r < ROWS; r++)
+	{
+		sLo[r] = pStatic[r].vals.octaWords[0].value;
+		sHi[r] = pStatic[r].vals.octaWords[1].value;
+	}
+
+	for (uint32_t j = 0; j < count; j++)
+	{
+		const __m256i dLo = pDyn[j].vals.octaWords[0].value;
+		const __m256i dHi = pDyn[j].vals.octaWords[1].value;
+
+		// Spill the XOR results and popcount them from memory, this keeps
+		// the lane extraction off port 5
+		__m256i_c v[2 * ROWS];
+
+		for (uint32_t r = 0; r < ROWS; r++)
+		{
+			_mm256_store_si256(&v[2 * r].value, _mm256_xor_si256(sLo[r], dLo));
+			_mm256_store_si256(&v[2 * r + 1].value, _mm256_xor_si256(sHi[r], dHi));
+		}
+
+		for (uint32_t r = 0; r < ROWS; r++)
+			pDist[j * AVX2_ROWS + r] = (uint16_t)(popcount256(v[2 * r].m256i_u64) + popcount256(v[2 * r + 1].m256i_u64));
+	}
+}
+
+void hammingBlockAvx2(const hash* pStatic, uint32_t rows, const hash* pDyn, uint32_t count, uint16_t* pDist)
+{
+	switch (rows)
+	{
+	case AVX2_ROWS:
+		hammingBlockAvx2Rows<4>(pStatic, pDyn, count, pDist);
+		break;
+	case 3:
+		hammingBlockAvx2Rows<3>(pStatic, pDyn, count, pDist);
+		break;
+	case 2:
+		hammingBlockAvx2Rows<2>(pStatic, pDyn, count, pDist);
+		break;
+	case 1:
+		hammingBlockAvx2Rows<1>(pStatic, pDyn, count, pDist);
+		break;
+	}
+}
+
+static const HammingKernel kernels[] =
+{
+	{ "avx512", AVX512_ROWS, hamming512Avx512, hammingBlockAvx512, nullptr },
+	{ "avx2-lut", AVX2_ROWS, hamming512Lut, hammingBlockLut, hammingSumHarleySeal },
+	{ "avx2", AVX2_ROWS, hamming512, hammingBlockAvx2, nullptr },
+	{ "scalar", SCALAR_ROWS, hamming512Scalar, hammingBlockScalar, nullptr }
+};
+
+static bool isSupported(const HammingKernel& k)
+{
+	const CpuFeatures& f = cpuFeatures();
+
+	if (strcmp(k.pName, "avx512") == 0)
+		return f.avx512vpopcntdq;
+	if (strcmp(k.pName, "avx2") == 0)
+		return f.avx2 && f.popcnt;
+	if (strcmp(k.pName, "avx2-lut") == 0)
+		return f.avx2;
+
+	return true;
+}
+
+const HammingKernel* selectKernel(const char* pName)
+{
+	const bool best = strcmp(pName, "auto") == 0;
+
+	// The table is sorted by preference
+	for (const HammingKernel& k : kernels)
+	{
+		if (best && isSupported(k))
+			return &k;
+
+		if (!best && strcmp(k.pName, pName) == 0)
+			return isSupported(k) ? &k : nullptr;
+	}
+
+	return nullptr;
+}
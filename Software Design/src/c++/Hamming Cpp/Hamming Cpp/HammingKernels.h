@@ -0,0 +1,74 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Hash.h"
+
+// Static hashes held in registers by the block kernels
+#define SCALAR_ROWS 4
+#define AVX2_ROWS 4
+#define AVX512_ROWS 8
+#define MAX_BLOCK_ROWS AVX512_ROWS
+
+/* Distance between two hashes */
+typedef uint32_t (*PairKernel)(const hash& a, const hash& b);
+
+/* Compute the distances between rows (<= HammingKernel::rows) static
+ * hashes and count dynamic hashes, pDist[j * HammingKernel::rows + r] is
+ * the distance between pStatic[r] and pDyn[j].
+ * */
+typedef void (*BlockKernel)(const hash* pStatic, uint32_t rows, const hash* pDyn, uint32_t count, uint16_t* pDist);
+
+/* Sum of the distances between one static hash and count dynamic hashes */
+typedef uint64_t (*SumKernel)(const hash& s, const hash* pDyn, uint32_t count);
+
+struct HammingKernel
+{
+	const char* pName;
+	uint32_t rows; // Static hashes per register block
+	PairKernel pair;
+	BlockKernel block;
+	SumKernel sum; // Optional, nullptr if the kernel has no dedicated sum
+};
+
+/* Select a kernel by name ("scalar", "avx2", "avx2-lut", "avx512"),
+ * "auto" picks the fastest one supported by the host CPU. Returns nullptr
+ * if the kernel is unknown or not supported.
+ * */
+const HammingKernel* selectKernel(const char* pName);
+
+uint32_t hamming512Scalar(const hash& a, const hash& b);
+void hammingBlockScalar(const hash* pStatic, uint32_t rows, const hash* pDyn, uint32_t count, uint16_t* pDist);
+
+void hammingBlockAvx2(const hash* pStatic, uint32_t rows, const hash* pDyn, uint32_t count, uint16_t* pDist);
+
+// PSHUFB nibble lookup, the sum uses Harley-Seal carry-save accumulation
+uint32_t hamming512Lut(const hash& a, const hash& b);
+void hammingBlockLut(const hash* pStatic, uint32_t rows, const hash* pDyn, uint32_t count, uint16_t* pDist);
+uint64_t hammingSumHarleySeal(const hash& s, const hash* pDyn, uint32_t count);
+
+// Require AVX-512F and AVX-512 VPOPCNTDQ
+uint32_t hamming512Avx512(const hash& a, const hash& b);
+void hammingBlockAvx512(const hash* pStatic, uint32_t rows, const hash* pDyn, uint32_t count, uint16_t* pDist);
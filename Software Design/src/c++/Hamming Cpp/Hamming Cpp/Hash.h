@@ -0,0 +1,206 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <nmmintrin.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+
+typedef union
+{
+	__m256i             value;
+	int8_t              m256i_i8[32];
+	int16_t             m256i_i16[16];
+	int32_t             m256i_i32[8];
+	int64_t             m256i_i64[4];
+	uint8_t             m256i_u8[32];
+	uint16_t            m256i_u16[16];
+	uint32_t            m256i_u32[8];
+	uint64_t            m256i_u64[4];
+} __m256i_c;
+
+struct hash
+{
+	union
+	{
+		uint8_t bytes[64];
+		uint64_t quadWords[8];
+		__m256i_c octaWords[2];
+
+	} vals;
+
+	hash operator^(const hash& h1) const
+	{
+		hash res;
+		for (int i = 0; i < 64; i++)
+			res.vals.bytes[i] = this->vals.bytes[i] ^ h1.vals.bytes[i];
+
+		return res;
+	}
+
+	friend std::ostream& operator<<(std::ostream& stream, const hash &h)
+	{
+		for (int i = 0; i < 64; i++)
+			stream << std::hex << std::setfill('0') << std::setw(2) << std::nouppercase << (int)h.vals.bytes[i];
+
+		return stream;
+	}
+};
+
+// Read only view of a contiguous hash array, either a mapped hash file or a vector
+struct HashView
+{
+	const hash* pData;
+	size_t count;
+
+	HashView() : pData(nullptr), count(0) {}
+	HashView(const hash* p, size_t c) : pData(p), count(c) {}
+
+	const hash* data() const { return pData; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	const hash& operator[](size_t i) const { return pData[i]; }
+	const hash& front() const { return pData[0]; }
+	const hash& back() const { return pData[count - 1]; }
+
+	const hash& at(size_t i) const
+	{
+		if (i >= count)
+			throw std::out_of_range("HashView::at");
+
+		return pData[i];
+	}
+};
+
+struct Result
+{
+	uint64_t val;
+
+	uint16_t dist;
+	uint32_t idxB;
+	uint32_t idxA;
+
+	Result(uint64_t v)
+	{
+		val = v;
+		CalcValues();
+	}
+
+	void CalcValues()
+	{
+		dist = (uint16_t)val & 0x3FF;
+		idxB = (uint32_t)(val >> 10) & 0x7FFFFFF;
+		idxA = (uint32_t)(val >> 37) & 0x7FFFFFF;
+	}
+
+	// Same layout as written by the hamming_dist OpenCL kernel
+	static uint64_t Pack(uint32_t dist, uint64_t idxB, uint64_t idxA)
+	{
+		return (uint64_t)dist | (idxB << 10) | (idxA << 37);
+	}
+
+};
+
+// Largest index that fits into the 27 bit index fields of a Result
+#define MAX_RESULT_INDEX 0x7FFFFFF
+
+inline uint8_t popCnt8(uint8_t uc)
+{
+	uint8_t n;
+	n = ((uc >> 1) & 0x55) + (uc & 0x55);
+	n = ((n >> 2) & 0x33) + (n & 0x33);
+	return (n >> 4) + (n & 0x0f);
+}
+
+inline uint32_t popCnt512(const hash& n)
+{
+	uint32_t res = 0;
+
+	for (int i = 0; i < 64; i++)
+		res += popCnt8(n.vals.bytes[i]);
+
+	return res;
+}
+
+inline uint64_t popcount256(const uint64_t* u)
+{
+	return _mm_popcnt_u64(u[0]) + _mm_popcnt_u64(u[1]) + _mm_popcnt_u64(u[2]) + _mm_popcnt_u64(u[3]);
+}
+
+inline uint32_t hamming512(const hash& a, const hash& b)
+{
+	uint64_t res = 0;
+	__m256i_c v;
+	v.value = _mm256_xor_si256(a.vals.octaWords[0].value, b.vals.octaWords[0].value);
+	res += popcount256(v.m256i_u64);
+	v.value = _mm256_xor_si256(a.vals.octaWords[1].value, b.vals.octaWords[1].value);
+	res += popcount256(v.m256i_u64);
+	return (uint32_t)res;
+}
+
+struct PruneStats
+{
+	uint64_t pairs;     // Pairs compared
+	uint64_t pruned128; // Rejected after the first 128 bits
+	uint64_t pruned256; // Rejected after the first 256 bits
+};
+
+/* Threshold-aware hamming512, the partial distance of a prefix is a lower
+ * bound of the full distance, so the comparison stops as soon as the first
+ * 128 or 256 bits already reach the threshold. In that case the returned
+ * value is only guaranteed to be >= threshold.
+ * */
+inline uint32_t hamming512EarlyAbort(const hash& a, const hash& b, uint32_t threshold, PruneStats& stats)
+{
+	const uint64_t* pA = a.vals.quadWords;
+	const uint64_t* pB = b.vals.quadWords;
+
+	stats.pairs++;
+
+	uint64_t res = _mm_popcnt_u64(pA[0] ^ pB[0]) + _mm_popcnt_u64(pA[1] ^ pB[1]);
+	if (res >= threshold)
+	{
+		stats.pruned128++;
+		return (uint32_t)res;
+	}
+
+	res += _mm_popcnt_u64(pA[2] ^ pB[2]) + _mm_popcnt_u64(pA[3] ^ pB[3]);
+	if (res >= threshold)
+	{
+		stats.pruned256++;
+		return (uint32_t)res;
+	}
+
+	res += _mm_popcnt_u64(pA[4] ^ pB[4]) + _mm_popcnt_u64(pA[5] ^ pB[5]) + _mm_popcnt_u64(pA[6] ^ pB[6]) + _mm_popcnt_u64(pA[7] ^ pB[7]);
+	return (uint32_t)res;
+}
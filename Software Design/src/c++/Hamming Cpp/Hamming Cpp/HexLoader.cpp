@@ -0,0 +1,200 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "HexLoader.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <iostream>
+#include <algorithm>
+
+#include "HashFile.h"
+#include "TiledKernel.h"
+
+#define HEX_DIGITS 128
+
+struct HexChunk
+{
+	const char* pBegin;
+	const char* pEnd;
+	size_t lines;   // Newlines in the chunk
+	size_t records; // Non empty lines
+	size_t badLine; // Chunk relative line of the first malformed record, SIZE_MAX if none
+};
+
+static bool isBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* Trims the line, returns false if nothing is left */
+static bool trimLine(const char*& pBegin, const char*& pEnd)
+{
+	while (pBegin < pEnd && isBlank(*pBegin))
+		pBegin++;
+
+	while (pEnd > pBegin && isBlank(pEnd[-1]))
+		pEnd--;
+
+	return pBegin != pEnd;
+}
+
+/* Values of 32 hex digits, valid is cleared for every other character.
+ * Digits and letters only differ in the upper nibble, so the value is
+ * the lower nibble plus 9 for letters.
+ * */
+static inline __m256i hexNibbles(__m256i v, __m256i& valid)
+{
+	const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+	const __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+	const __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+
+	valid = _mm256_and_si256(valid, _mm256_or_si256(digit, alpha));
+	return _mm256_add_epi8(_mm256_and_si256(v, _mm256_set1_epi8(0x0F)), _mm256_and_si256(alpha, _mm256_set1_epi8(9)));
+}
+
+/* Decodes 128 hex digits into a hash, returns false on invalid digits */
+static inline bool decodeHash(const char* pIn, hash& out)
+{
+	// maddubs weights, 16 for the high and 1 for the low nibble of a byte
+	const __m256i weights = _mm256_set1_epi16(0x0110);
+	__m256i valid = _mm256_set1_epi8(-1);
+
+	for (int i = 0; i < 2; i++)
+	{
+		const __m256i a = hexNibbles(_mm256_loadu_si256((const __m256i*)(pIn + i * 64)), valid);
+		const __m256i b = hexNibbles(_mm256_loadu_si256((const __m256i*)(pIn + i * 64 + 32)), valid);
+
+		// packus interleaves the 128 bit lanes of a and b, the permute restores the order
+		const __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(a, weights), _mm256_maddubs_epi16(b, weights));
+		_mm256_storeu_si256(&out.vals.octaWords[i].value, _mm256_permute4x64_epi64(bytes, _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	return _mm256_movemask_epi8(valid) == -1;
+}
+
+/* Counts lines and records of a chunk, pOut == nullptr, or decodes the
+ * records to pOut and stops at the first malformed one
+ * */
+static void scanChunk(HexChunk& c, hash* pOut)
+{
+	size_t line = 0;
+	size_t records = 0;
+	const char* p = c.pBegin;
+
+	while (p < c.pEnd)
+	{
+		const char* pNewline = (const char*)memchr(p, '\n', c.pEnd - p);
+		const char* pLineEnd = pNewline ? pNewline : c.pEnd;
+		const char* pBegin = p;
+		const char* pEnd = pLineEnd;
+
+		if (trimLine(pBegin, pEnd))
+		{
+			if (pOut)
+			{
+				if (pEnd - pBegin > 2 && pBegin[0] == '0' && (pBegin[1] == 'x' || pBegin[1] == 'X'))
+					pBegin += 2;
+
+				if (pEnd - pBegin != HEX_DIGITS || !decodeHash(pBegin, pOut[records]))
+				{
+					c.badLine = line;
+					return;
+				}
+			}
+
+			records++;
+		}
+
+		line++;
+		p = pLineEnd + 1;
+	}
+
+	c.lines = line;
+	c.records = records;
+}
+
+bool readHexFile(const char* pFilename, HashVector& data)
+{
+	MappedFile file;
+
+	if (!file.open(pFilename))
+		return false;
+
+	const char* pText = (const char*)file.data();
+	const size_t size = file.size();
+	const int chunks = size > (1 << 20) ? maxThreads() : 1;
+
+	// Newline aligned chunks, every chunk starts right after a newline
+	std::vector<HexChunk> c(chunks);
+	const char* pPrev = pText;
+
+	for (int t = 0; t < chunks; t++)
+	{
+		const char* pSplit = pText + size;
+
+		if (t + 1 < chunks)
+		{
+			pSplit = std::max(pPrev, pText + size / chunks * (t + 1));
+			const char* pNewline = (const char*)memchr(pSplit, '\n', pText + size - pSplit);
+			pSplit = pNewline ? pNewline + 1 : pText + size;
+		}
+
+		c[t] = { pPrev, pSplit, 0, 0, SIZE_MAX };
+		pPrev = pSplit;
+	}
+
+	int t;
+
+#pragma omp parallel for private(t)
+	for (t = 0; t < chunks; t++)
+		scanChunk(c[t], nullptr);
+
+	std::vector<size_t> offsets(chunks + 1, 0);
+
+	for (t = 0; t < chunks; t++)
+		offsets[t + 1] = offsets[t] + c[t].records;
+
+	data.resize(offsets[chunks]);
+
+#pragma omp parallel for private(t)
+	for (t = 0; t < chunks; t++)
+		scanChunk(c[t], data.data() + offsets[t]);
+
+	size_t lineBase = 0;
+
+	for (t = 0; t < chunks; t++)
+	{
+		if (c[t].badLine != SIZE_MAX)
+		{
+			std::cout << "Line " << lineBase + c[t].badLine + 1 << " of " << pFilename << " is not a hex encoded 512 bit hash." << std::endl;
+			data.clear();
+			return false;
+		}
+
+		lineBase += c[t].lines;
+	}
+
+	return true;
+}
@@ -0,0 +1,233 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "MultiIndex.h"
+#include "TiledKernel.h"
+
+#include <algorithm>
+#include <math.h>
+
+// Cost of a table probe and of a candidate check in distances of the
+// tiled scan, both are dominated by cache misses
+#define MIH_PROBE_COST 32
+#define MIH_CANDIDATE_COST 8
+
+MultiIndex::MultiIndex(const hash* pStatic, size_t staticSize, uint32_t substrings) :
+	m_pStatic(pStatic),
+	m_staticSize(staticSize),
+	m_substrings(substrings),
+	m_bits(512 / substrings),
+	m_direct(m_bits <= 16),
+	m_tables(substrings)
+{
+	int k;
+
+#pragma omp parallel for private(k)
+	for (k = 0; k < (int)m_substrings; k++)
+	{
+		Table& t = m_tables[k];
+
+		// Sort the static hashes by their substring, then compress
+		std::vector<std::pair<uint64_t, uint32_t>> entries(m_staticSize);
+
+		for (size_t i = 0; i < m_staticSize; i++)
+			entries[i] = std::make_pair(substring(m_pStatic[i], k), (uint32_t)i);
+
+		std::sort(entries.begin(), entries.end());
+
+		t.ids.resize(m_staticSize);
+
+		for (size_t i = 0; i < m_staticSize; i++)
+			t.ids[i] = entries[i].second;
+
+		if (m_direct)
+		{
+			t.offsets.assign(((size_t)1 << m_bits) + 1, 0);
+
+			for (size_t i = 0; i < m_staticSize; i++)
+				t.offsets[entries[i].first + 1]++;
+
+			for (size_t b = 1; b < t.offsets.size(); b++)
+				t.offsets[b] += t.offsets[b - 1];
+		}
+		else
+		{
+			for (size_t i = 0; i < m_staticSize; i++)
+			{
+				if (i == 0 || entries[i].first != entries[i - 1].first)
+				{
+					t.keys.push_back(entries[i].first);
+					t.offsets.push_back((uint32_t)i);
+				}
+			}
+
+			t.offsets.push_back((uint32_t)m_staticSize);
+		}
+	}
+}
+
+uint32_t MultiIndex::chooseSubstrings(size_t staticSize, uint32_t threshold)
+{
+	uint32_t best = 0;
+	double bestCost = (double)staticSize;
+
+	for (uint32_t m = 8; m <= 64; m *= 2)
+	{
+		// A key of a bucket matches with a probability of 2^-bits
+		const double probes = probesPerQuery(m, threshold);
+		const double candidates = std::min(probes * staticSize / pow(2.0, 512 / m), (double)staticSize);
+		const double cost = probes * MIH_PROBE_COST + candidates * MIH_CANDIDATE_COST;
+
+		if (cost < bestCost)
+		{
+			best = m;
+			bestCost = cost;
+		}
+	}
+
+	return best;
+}
+
+double MultiIndex::probesPerQuery(uint32_t substrings, uint32_t threshold)
+{
+	if (threshold == 0)
+		return 0.0;
+
+	const uint32_t bits = 512 / substrings;
+	const uint32_t radius = std::min((threshold - 1) / substrings, bits);
+	double keys = 0.0;
+	double binom = 1.0;
+
+	for (uint32_t i = 0; i <= radius; i++)
+	{
+		keys += binom;
+		binom = binom * (bits - i) / (i + 1);
+	}
+
+	return substrings * keys;
+}
+
+uint64_t MultiIndex::substring(const hash& h, uint32_t k) const
+{
+	const uint32_t bit = k * m_bits;
+	const uint64_t word = h.vals.quadWords[bit / 64] >> (bit % 64);
+
+	return m_bits == 64 ? word : word & (((uint64_t)1 << m_bits) - 1);
+}
+
+// Call func for every key within flips bit flips of key, only bits >= firstBit are flipped
+template <typename Func>
+void MultiIndex::probe(uint32_t k, uint64_t key, uint32_t firstBit, uint32_t flips, Func& func) const
+{
+	func(key);
+
+	if (flips == 0)
+		return;
+
+	for (uint32_t b = firstBit; b < m_bits; b++)
+		probe(k, key ^ ((uint64_t)1 << b), b + 1, flips - 1, func);
+}
+
+void MultiIndex::search(const hash& q, size_t qIdx, uint32_t threshold, int tid, ThresholdSink& sink, std::vector<uint32_t>& seen, uint32_t stamp, MultiIndexStats& stats) const
+{
+	if (threshold == 0)
+		return;
+
+	// dist < threshold <=> dist <= r, one substring is within r / m
+	const uint32_t radius = (threshold - 1) / m_substrings;
+
+	stats.queries++;
+
+	for (uint32_t k = 0; k < m_substrings; k++)
+	{
+		const Table& t = m_tables[k];
+
+		auto lookup = [&](uint64_t key)
+		{
+			stats.probes++;
+
+			size_t bucket;
+
+			if (m_direct)
+				bucket = (size_t)key;
+			else
+			{
+				std::vector<uint64_t>::const_iterator it = std::lower_bound(t.keys.begin(), t.keys.end(), key);
+
+				if (it == t.keys.end() || *it != key)
+					return;
+
+				bucket = it - t.keys.begin();
+			}
+
+			for (uint32_t e = t.offsets[bucket]; e < t.offsets[bucket + 1]; e++)
+			{
+				const uint32_t i = t.ids[e];
+
+				if (seen[i] == stamp)
+					continue;
+
+				seen[i] = stamp;
+				stats.candidates++;
+
+				const uint32_t dist = hamming512(m_pStatic[i], q);
+
+				if (dist < threshold)
+					sink.add(tid, Result::Pack(dist, qIdx, i));
+			}
+		};
+
+		probe(k, substring(q, k), 0, std::min(radius, m_bits), lookup);
+	}
+}
+
+void multiIndexSearch(const MultiIndex& index, const hash* pDyn, size_t dynSize, uint32_t threshold, ThresholdSink& sink, MultiIndexStats& stats)
+{
+	uint64_t queries = 0;
+	uint64_t probes = 0;
+	uint64_t candidates = 0;
+
+#pragma omp parallel reduction(+:queries, probes, candidates)
+	{
+#ifdef _OPENMP
+		const int tid = omp_get_thread_num();
+#else
+		const int tid = 0;
+#endif
+		MultiIndexStats local = { 0, 0, 0 };
+		std::vector<uint32_t> seen(index.staticSize(), UINT32_MAX);
+
+#pragma omp for schedule(dynamic, 64)
+		for (int64_t j = 0; j < (int64_t)dynSize; j++)
+			index.search(pDyn[j], j, threshold, tid, sink, seen, (uint32_t)j, local);
+
+		queries += local.queries;
+		probes += local.probes;
+		candidates += local.candidates;
+	}
+
+	stats.queries = queries;
+	stats.probes = probes;
+	stats.candidates = candidates;
+}
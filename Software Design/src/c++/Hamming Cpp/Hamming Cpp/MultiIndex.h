@@ -0,0 +1,102 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Hash.h"
+#include "ThresholdSink.h"
+
+struct MultiIndexStats
+{
+	uint64_t queries;
+	uint64_t probes;     // Table lookups
+	uint64_t candidates; // Distinct static hashes verified with hamming512
+};
+
+/* Multi-index hashing after Norouzi et al., "Fast Search in Hamming Space
+ * with Multi-Index Hashing". Every 512 bit hash is split into m disjoint
+ * substrings of 512 / m bits, each of them keys one table. If two hashes
+ * are within radius r, at least one pair of substrings is within
+ * floor(r / m) (pigeonhole principle), so probing every table with all
+ * keys in that radius yields a superset of the matches.
+ * */
+class MultiIndex
+{
+public:
+	/* substrings has to be 8, 16, 32 or 64 */
+	MultiIndex(const hash* pStatic, size_t staticSize, uint32_t substrings);
+
+	/* Substring count with the lowest estimated cost per query, the
+	 * probes plus the expected candidates for uniformly distributed
+	 * hashes. Returns 0 if no substring count beats a scan of the static
+	 * set.
+	 * */
+	static uint32_t chooseSubstrings(size_t staticSize, uint32_t threshold);
+
+	/* Table lookups per query, the keys within the search radius of all
+	 * substrings. Grows with the radius like sum C(512 / m, i), i <= r.
+	 * */
+	static double probesPerQuery(uint32_t substrings, uint32_t threshold);
+
+	uint32_t substrings() const { return m_substrings; }
+	size_t staticSize() const { return m_staticSize; }
+
+	/* Add all static hashes with a distance below threshold to q to the
+	 * sink. seen has to hold one entry per static hash and is used to
+	 * skip candidates found in more than one table, stamp has to be
+	 * unique per query.
+	 * */
+	void search(const hash& q, size_t qIdx, uint32_t threshold, int tid, ThresholdSink& sink, std::vector<uint32_t>& seen, uint32_t stamp, MultiIndexStats& stats) const;
+
+private:
+	uint64_t substring(const hash& h, uint32_t k) const;
+
+	template <typename Func>
+	void probe(uint32_t k, uint64_t key, uint32_t firstBit, uint32_t flips, Func& func) const;
+
+	struct Table
+	{
+		// CSR layout, ids[offsets[b] .. offsets[b + 1]) are the static
+		// hashes of bucket b. Narrow substrings (<= 16 bit) are addressed
+		// directly, wider ones through the sorted keys.
+		std::vector<uint64_t> keys;
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> ids;
+	};
+
+	const hash* m_pStatic;
+	size_t m_staticSize;
+	uint32_t m_substrings;
+	uint32_t m_bits;
+	bool m_direct;
+	std::vector<Table> m_tables;
+};
+
+/* Radius search of every dynamic hash against the index, matches below
+ * the threshold are added to the sink as packed Result words
+ * */
+void multiIndexSearch(const MultiIndex& index, const hash* pDyn, size_t dynSize, uint32_t threshold, ThresholdSink& sink, MultiIndexStats& stats);
@@ -0,0 +1,150 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PopcountBench.h"
+#include "HammingKernels.h"
+#include "CpuFeatures.h"
+#include "Timer.h"
+
+#include <stdio.h>
+#include <random>
+#include <vector>
+
+#define BENCH_STATIC_SIZE 8
+#define BENCH_DYN_SIZE 2048 // 128 KiB, stays in L2
+#define BENCH_MIN_TIME_MS 250.0
+
+// Sink for the results so nothing gets optimized away
+static volatile uint64_t benchSink;
+
+static uint32_t hamming512Popcnt64(const hash& a, const hash& b)
+{
+	uint64_t res = 0;
+
+	for (int k = 0; k < 8; k++)
+		res += _mm_popcnt_u64(a.vals.quadWords[k] ^ b.vals.quadWords[k]);
+
+	return (uint32_t)res;
+}
+
+/* Repeat the all-pairs run of func until BENCH_MIN_TIME_MS passed and
+ * print the reached comparisons per second
+ * */
+template <typename Func>
+static void bench(const char* pName, Func func)
+{
+	Timer t;
+	uint64_t runs = 0;
+	uint64_t sum = 0;
+
+	t.start();
+
+	do
+	{
+		sum += func();
+		runs++;
+	} while (t.getElapsedTimeInMilliSec() < BENCH_MIN_TIME_MS);
+
+	t.stop();
+	benchSink = sum;
+
+	const double cmps = (double)runs * BENCH_STATIC_SIZE * BENCH_DYN_SIZE;
+	printf("%-28s %10.3f Mh/s (checksum %llu)\n", pName, cmps / t.getElapsedTimeInSec() / 1e6, (unsigned long long)(sum / runs));
+}
+
+template <PairKernel PAIR>
+static uint64_t runPair(const std::vector<hash>& s, const std::vector<hash>& d)
+{
+	uint64_t sum = 0;
+
+	for (size_t r = 0; r < s.size(); r++)
+		for (size_t j = 0; j < d.size(); j++)
+			sum += PAIR(s[r], d[j]);
+
+	return sum;
+}
+
+static uint64_t runBlock(const HammingKernel& k, const std::vector<hash>& s, const std::vector<hash>& d, std::vector<uint16_t>& dist)
+{
+	uint64_t sum = 0;
+
+	for (size_t r = 0; r < s.size(); r += k.rows)
+	{
+		k.block(&s[r], k.rows, d.data(), (uint32_t)d.size(), dist.data());
+
+		for (size_t i = 0; i < dist.size(); i++)
+			sum += dist[i];
+	}
+
+	return sum;
+}
+
+void runPopcountBenchmark()
+{
+	std::mt19937_64 rng(42);
+	std::vector<hash> s(BENCH_STATIC_SIZE);
+	std::vector<hash> d(BENCH_DYN_SIZE);
+
+	for (hash& h : s)
+		for (uint64_t& q : h.vals.quadWords)
+			q = rng();
+
+	for (hash& h : d)
+		for (uint64_t& q : h.vals.quadWords)
+			q = rng();
+
+	printf("---Popcount benchmark (%d x %d)---\n", BENCH_STATIC_SIZE, BENCH_DYN_SIZE);
+
+	bench("pair popCnt8", [&]() { return runPair<hamming512Scalar>(s, d); });
+	bench("pair popcount256", [&]() { return runPair<hamming512>(s, d); });
+	bench("pair _mm_popcnt_u64", [&]() { return runPair<hamming512Popcnt64>(s, d); });
+	bench("pair avx2 nibble lut", [&]() { return runPair<hamming512Lut>(s, d); });
+
+	if (cpuFeatures().avx512vpopcntdq)
+		bench("pair avx512 vpopcntdq", [&]() { return runPair<hamming512Avx512>(s, d); });
+
+	const char* blockKernels[] = { "avx2", "avx2-lut", "avx512" };
+
+	for (const char* pName : blockKernels)
+	{
+		const HammingKernel* pKernel = selectKernel(pName);
+
+		if (pKernel == nullptr)
+			continue;
+
+		std::vector<uint16_t> dist(pKernel->rows * d.size());
+		std::string name = std::string("block ") + pName;
+		bench(name.c_str(), [&]() { return runBlock(*pKernel, s, d, dist); });
+	}
+
+	bench("sum avx2 harley-seal", [&]()
+	{
+		uint64_t sum = 0;
+
+		for (size_t r = 0; r < s.size(); r++)
+			sum += hammingSumHarleySeal(s[r], d.data(), (uint32_t)d.size());
+
+		return sum;
+	});
+}
@@ -0,0 +1,113 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PopcountBuckets.h"
+
+#include <algorithm>
+
+PopcountBuckets::PopcountBuckets(const hash* pData, size_t size, uint32_t width) :
+	data(size),
+	index(size),
+	offsets(512 / width + 2, 0),
+	width(width)
+{
+	std::vector<uint16_t> pop(size);
+	int64_t i;
+
+#pragma omp parallel for private(i)
+	for (i = 0; i < (int64_t)size; i++)
+		pop[i] = (uint16_t)(_mm_popcnt_u64(pData[i].vals.quadWords[0]) + _mm_popcnt_u64(pData[i].vals.quadWords[1])
+		                    + _mm_popcnt_u64(pData[i].vals.quadWords[2]) + _mm_popcnt_u64(pData[i].vals.quadWords[3])
+		                    + _mm_popcnt_u64(pData[i].vals.quadWords[4]) + _mm_popcnt_u64(pData[i].vals.quadWords[5])
+		                    + _mm_popcnt_u64(pData[i].vals.quadWords[6]) + _mm_popcnt_u64(pData[i].vals.quadWords[7]));
+
+	// Counting sort, stable so the original order is kept within a bucket
+	for (size_t j = 0; j < size; j++)
+		offsets[pop[j] / width + 1]++;
+
+	for (size_t b = 1; b < offsets.size(); b++)
+		offsets[b] += offsets[b - 1];
+
+	std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+
+	for (size_t j = 0; j < size; j++)
+	{
+		const size_t pos = fill[pop[j] / width]++;
+		data[pos] = pData[j];
+		index[pos] = (uint32_t)j;
+	}
+}
+
+void bucketedThresholdSearch(const HammingKernel& kernel, const PopcountBuckets& staticBuckets, const PopcountBuckets& dynBuckets, uint32_t threshold, const TileShape& shape, ThresholdSink& sink, BucketStats& stats)
+{
+	const uint32_t w = staticBuckets.width;
+
+	stats.bucketPairs = 0;
+	stats.skippedBucketPairs = 0;
+	stats.skippedPairs = 0;
+
+	for (uint32_t a = 0; a < staticBuckets.buckets(); a++)
+	{
+		const size_t sBegin = staticBuckets.offsets[a];
+		const size_t sCnt = staticBuckets.offsets[a + 1] - sBegin;
+
+		if (sCnt == 0)
+			continue;
+
+		// Dynamic buckets that can hold a match form a contiguous range
+		size_t dBegin = 0;
+		size_t dEnd = 0;
+
+		for (uint32_t b = 0; b < dynBuckets.buckets(); b++)
+		{
+			const size_t dCnt = dynBuckets.offsets[b + 1] - dynBuckets.offsets[b];
+
+			if (dCnt == 0)
+				continue;
+
+			// Smallest popcount gap between the two buckets
+			const uint32_t gap = a == b ? 0 : (a < b ? b - a : a - b) * w - (w - 1);
+
+			stats.bucketPairs++;
+
+			if (gap >= threshold)
+			{
+				stats.skippedBucketPairs++;
+				stats.skippedPairs += sCnt * dCnt;
+				continue;
+			}
+
+			if (dEnd == 0)
+				dBegin = dynBuckets.offsets[b];
+
+			dEnd = dynBuckets.offsets[b + 1];
+		}
+
+		if (dEnd > dBegin)
+		{
+			OffsetSink<ThresholdSink> offsetSink(sink, sBegin, dBegin);
+			tiledAllPairs(kernel, &staticBuckets.data[sBegin], sCnt, &dynBuckets.data[dBegin], dEnd - dBegin, shape, offsetSink);
+		}
+	}
+}
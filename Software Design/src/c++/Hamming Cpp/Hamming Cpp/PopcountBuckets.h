@@ -0,0 +1,61 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Hash.h"
+#include "ThresholdSink.h"
+#include "TiledKernel.h"
+
+/* Copy of a hash set sorted by popcount and grouped into buckets of
+ * width consecutive popcount values.
+ * */
+struct PopcountBuckets
+{
+	PopcountBuckets(const hash* pData, size_t size, uint32_t width);
+
+	uint32_t buckets() const { return (uint32_t)offsets.size() - 1; }
+
+	std::vector<hash> data;     // Sorted by popcount
+	std::vector<uint32_t> index; // Original index of data[i]
+	std::vector<size_t> offsets; // Bucket b is data[offsets[b] .. offsets[b + 1])
+	uint32_t width;
+};
+
+struct BucketStats
+{
+	uint64_t bucketPairs; // Pairs of non-empty buckets
+	uint64_t skippedBucketPairs;
+	uint64_t skippedPairs; // Hash pairs never compared
+};
+
+/* Threshold search on popcount bucketed sets. The distance of two hashes is
+ * at least |pop(a) - pop(b)|, so bucket pairs whose popcount gap reaches
+ * the threshold are skipped entirely. The sink receives indices into the
+ * sorted sets, use index to map them back.
+ * */
+void bucketedThresholdSearch(const HammingKernel& kernel, const PopcountBuckets& staticBuckets, const PopcountBuckets& dynBuckets, uint32_t threshold, const TileShape& shape, ThresholdSink& sink, BucketStats& stats);
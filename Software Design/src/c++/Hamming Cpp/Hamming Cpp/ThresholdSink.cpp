@@ -0,0 +1,81 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "ThresholdSink.h"
+
+#include <algorithm>
+
+#define INITIAL_BUFFER_SIZE 4096
+
+ThresholdSink::ThresholdSink(int threads, uint32_t threshold) :
+	m_buffers(threads),
+	m_threshold(threshold)
+{
+	for (Buffer& b : m_buffers)
+	{
+		b.results.resize(INITIAL_BUFFER_SIZE);
+		b.cnt = 0;
+	}
+}
+
+static bool resultLess(uint64_t a, uint64_t b)
+{
+	const Result ra(a);
+	const Result rb(b);
+
+	if (ra.idxB != rb.idxB)
+		return ra.idxB < rb.idxB;
+
+	return ra.idxA < rb.idxA;
+}
+
+ResultVector ThresholdSink::merge(const uint32_t* pStaticMap, const uint32_t* pDynMap)
+{
+	const int threads = (int)m_buffers.size();
+	std::vector<size_t> offsets(threads + 1, 0);
+
+	for (int t = 0; t < threads; t++)
+		offsets[t + 1] = offsets[t] + m_buffers[t].cnt;
+
+	ResultVector res(offsets[threads]);
+	int t;
+
+	// Every thread owns a disjoint slice of the output
+#pragma omp parallel for private(t)
+	for (t = 0; t < threads; t++)
+		std::copy(m_buffers[t].results.begin(), m_buffers[t].results.begin() + m_buffers[t].cnt, res.begin() + offsets[t]);
+
+	if (pStaticMap || pDynMap)
+	{
+		for (uint64_t& v : res)
+		{
+			Result r(v);
+			v = Result::Pack(r.dist, pDynMap ? pDynMap[r.idxB] : r.idxB, pStaticMap ? pStaticMap[r.idxA] : r.idxA);
+		}
+	}
+
+	std::sort(res.begin(), res.end(), resultLess);
+
+	return res;
+}
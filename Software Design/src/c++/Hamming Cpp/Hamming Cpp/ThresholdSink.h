@@ -0,0 +1,98 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "AlignedAllocator.h"
+#include "Hash.h"
+
+typedef std::vector<uint64_t, AlignedAllocator<uint64_t, 64>> ResultVector;
+
+/* Collects every pair with a distance below the threshold as a packed
+ * Result word. Each thread appends to its own cache line aligned buffer,
+ * merge() joins them without locks.
+ * */
+class ThresholdSink
+{
+public:
+	ThresholdSink(int threads, uint32_t threshold);
+
+	void operator()(int tid, size_t staticIdx, uint32_t rows, size_t dynIdx, uint32_t count, const uint16_t* pDist, uint32_t stride)
+	{
+		Buffer& b = m_buffers[tid];
+
+		// Every candidate is written unconditionally, only the fill level
+		// depends on the compare, so make sure a whole block fits
+		const size_t block = (size_t)rows * count;
+		if (b.results.size() < b.cnt + block)
+			b.results.resize(std::max(b.results.size() * 2, b.cnt + block));
+
+		uint64_t* pOut = b.results.data();
+		size_t cnt = b.cnt;
+
+		for (uint32_t j = 0; j < count; j++)
+		{
+			for (uint32_t r = 0; r < rows; r++)
+			{
+				const uint32_t dist = pDist[j * stride + r];
+				pOut[cnt] = Result::Pack(dist, dynIdx + j, staticIdx + r);
+				cnt += dist < m_threshold;
+			}
+		}
+
+		b.cnt = cnt;
+	}
+
+	// Append a single packed Result, for callers that filter on their own
+	void add(int tid, uint64_t result)
+	{
+		Buffer& b = m_buffers[tid];
+
+		if (b.results.size() == b.cnt)
+			b.results.resize(b.results.size() * 2);
+
+		b.results[b.cnt++] = result;
+	}
+
+	/* Concatenate the per thread buffers, sorted by dynamic and then by
+	 * static index so the output does not depend on the scheduling.
+	 * If the search ran on reordered sets, the maps translate the indices
+	 * back to the original order.
+	 * */
+	ResultVector merge(const uint32_t* pStaticMap = nullptr, const uint32_t* pDynMap = nullptr);
+
+private:
+	struct alignas(64) Buffer
+	{
+		ResultVector results;
+		size_t cnt;
+	};
+
+	std::vector<Buffer> m_buffers;
+	uint32_t m_threshold;
+};
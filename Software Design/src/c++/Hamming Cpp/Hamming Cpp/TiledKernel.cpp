@@ -0,0 +1,91 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "TiledKernel.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define DEFAULT_L1_SIZE (32 * 1024)
+#define DEFAULT_L2_SIZE (256 * 1024)
+
+static void getCacheSizes(size_t& l1, size_t& l2)
+{
+	l1 = 0;
+	l2 = 0;
+
+#ifdef _WIN32
+	DWORD len = 0;
+	GetLogicalProcessorInformation(nullptr, &len);
+	std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(len / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+
+	if (!info.empty() && GetLogicalProcessorInformation(info.data(), &len))
+	{
+		for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& i : info)
+		{
+			if (i.Relationship != RelationCache || i.Cache.Type == CacheInstruction)
+				continue;
+
+			if (i.Cache.Level == 1)
+				l1 = i.Cache.Size;
+			else if (i.Cache.Level == 2)
+				l2 = i.Cache.Size;
+		}
+	}
+#elif defined(_SC_LEVEL1_DCACHE_SIZE)
+	long v = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+	if (v > 0)
+		l1 = v;
+
+	v = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	if (v > 0)
+		l2 = v;
+#endif
+
+	if (l1 == 0)
+		l1 = DEFAULT_L1_SIZE;
+	if (l2 == 0)
+		l2 = DEFAULT_L2_SIZE;
+}
+
+TileShape calcTileShape()
+{
+	size_t l1, l2;
+	getCacheSizes(l1, l2);
+
+	TileShape shape;
+
+	// Half of L1 for the dynamic tile, the rest is left for the distance
+	// buffer and the stack
+	shape.dynTile = (uint32_t)std::max((size_t)16, (l1 / 2 / sizeof(hash)) & ~(size_t)15);
+
+	// Half of L2 for the static tile, a quarter for the group of dynamic tiles
+	shape.staticTile = (uint32_t)std::max((size_t)MAX_BLOCK_ROWS, (l2 / 2 / sizeof(hash)) & ~(size_t)(MAX_BLOCK_ROWS - 1));
+	shape.dynGroup = (uint32_t)std::max((size_t)1, l2 / 4 / (shape.dynTile * sizeof(hash)));
+
+	return shape;
+}
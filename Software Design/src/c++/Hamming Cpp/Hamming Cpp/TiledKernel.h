@@ -0,0 +1,126 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "HammingKernels.h"
+
+inline int maxThreads()
+{
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+struct TileShape
+{
+	uint32_t staticTile; // Static hashes per L2 tile
+	uint32_t dynTile;    // Dynamic hashes per L1 tile
+	uint32_t dynGroup;   // L1 tiles sharing one pass over a static tile
+};
+
+/* Derive the tile shape from the L1/L2 data cache sizes of the host, a
+ * dynamic tile takes half of L1, a static tile and a group of dynamic
+ * tiles share L2.
+ * */
+TileShape calcTileShape();
+
+/* Tiled all-pairs comparison of the static and the dynamic set. For every
+ * register block the sink is called with
+ *   sink(threadId, staticIdx, rows, dynIdx, count, pDist, stride)
+ * where pDist[j * stride + r] is the distance between static hash
+ * staticIdx + r and dynamic hash dynIdx + j.
+ * */
+template <typename Sink>
+void tiledAllPairs(const HammingKernel& kernel, const hash* pStatic, size_t staticSize, const hash* pDyn, size_t dynSize, const TileShape& shape, Sink& sink)
+{
+	const size_t groupSize = (size_t)shape.dynTile * shape.dynGroup;
+	const int groups = (int)((dynSize + groupSize - 1) / groupSize);
+
+#pragma omp parallel
+	{
+#ifdef _OPENMP
+		const int tid = omp_get_thread_num();
+#else
+		const int tid = 0;
+#endif
+		std::vector<uint16_t> dist(kernel.rows * shape.dynTile);
+
+#pragma omp for schedule(dynamic)
+		for (int g = 0; g < groups; g++)
+		{
+			const size_t gBegin = g * groupSize;
+			const size_t gEnd = std::min(gBegin + groupSize, dynSize);
+
+			for (size_t s0 = 0; s0 < staticSize; s0 += shape.staticTile)
+			{
+				const size_t sEnd = std::min(s0 + shape.staticTile, staticSize);
+
+				for (size_t d = gBegin; d < gEnd; d += shape.dynTile)
+				{
+					const uint32_t count = (uint32_t)std::min((size_t)shape.dynTile, gEnd - d);
+
+					for (size_t s = s0; s < sEnd; s += kernel.rows)
+					{
+						const uint32_t rows = (uint32_t)std::min((size_t)kernel.rows, sEnd - s);
+
+						kernel.block(&pStatic[s], rows, &pDyn[d], count, dist.data());
+						sink(tid, s, rows, d, count, dist.data(), kernel.rows);
+					}
+				}
+			}
+		}
+	}
+}
+
+/* Forwards to another sink with the indices shifted by a fixed offset,
+ * for running tiledAllPairs on a sub range of the sets
+ * */
+template <typename Sink>
+struct OffsetSink
+{
+	Sink& sink;
+	size_t staticBase;
+	size_t dynBase;
+
+	OffsetSink(Sink& sink, size_t staticBase, size_t dynBase) :
+		sink(sink),
+		staticBase(staticBase),
+		dynBase(dynBase)
+	{
+	}
+
+	void operator()(int tid, size_t staticIdx, uint32_t rows, size_t dynIdx, uint32_t count, const uint16_t* pDist, uint32_t stride)
+	{
+		sink(tid, staticIdx + staticBase, rows, dynIdx + dynBase, count, pDist, stride);
+	}
+};
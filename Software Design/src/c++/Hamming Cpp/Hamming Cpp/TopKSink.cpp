@@ -0,0 +1,54 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "TopKSink.h"
+
+TopKSink::TopKSink(size_t dynSize, uint32_t k, uint64_t* pOut) :
+	m_pOut(pOut),
+	m_dynSize(dynSize),
+	m_k(k),
+	m_sizes(dynSize, 0)
+{
+}
+
+void TopKSink::finish()
+{
+	const int64_t dynSize = (int64_t)m_dynSize;
+	int64_t q;
+
+#pragma omp parallel for private(q)
+	for (q = 0; q < dynSize; q++)
+	{
+		uint64_t* pHeap = &m_pOut[q * m_k];
+		const uint32_t size = m_sizes[q];
+
+		std::sort_heap(pHeap, pHeap + size);
+
+		for (uint32_t i = 0; i < size; i++)
+			pHeap[i] = Result::Pack((uint32_t)(pHeap[i] >> 27), q, pHeap[i] & MAX_RESULT_INDEX);
+
+		for (uint32_t i = size; i < m_k; i++)
+			pHeap[i] = TOP_K_EMPTY_RESULT;
+	}
+}
@@ -0,0 +1,94 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "Hash.h"
+
+#define MAX_TOP_K 64
+
+// Fills the slots of queries that have fewer than k static candidates
+#define TOP_K_EMPTY_RESULT Result::Pack(0x3FF, 0, MAX_RESULT_INDEX)
+
+/* Keeps the k closest static hashes of every dynamic hash (query).
+ *
+ * The k slots of a query in the output array double as its bounded max
+ * heap of (dist << 27 | idxA) keys, so no memory besides the output is
+ * needed. The current worst key acts as an adaptive threshold: once the
+ * heap is full, a candidate is dropped with a single compare. Ties are
+ * broken by the static index, the result does not depend on the order
+ * in which the candidates arrive.
+ *
+ * A query has to be processed by a single thread, tiledAllPairs
+ * guarantees this by handing out whole dynamic tiles.
+ * */
+class TopKSink
+{
+public:
+	TopKSink(size_t dynSize, uint32_t k, uint64_t* pOut);
+
+	void operator()(int /*tid*/, size_t staticIdx, uint32_t rows, size_t dynIdx, uint32_t count, const uint16_t* pDist, uint32_t stride)
+	{
+		for (uint32_t j = 0; j < count; j++)
+		{
+			const size_t q = dynIdx + j;
+			uint64_t* pHeap = &m_pOut[q * m_k];
+			uint8_t& size = m_sizes[q];
+			uint64_t worst = size == m_k ? pHeap[0] : UINT64_MAX;
+
+			for (uint32_t r = 0; r < rows; r++)
+			{
+				const uint64_t key = ((uint64_t)pDist[j * stride + r] << 27) | (staticIdx + r);
+
+				if (key >= worst)
+					continue;
+
+				if (size == m_k)
+					std::pop_heap(pHeap, pHeap + size--);
+
+				pHeap[size++] = key;
+				std::push_heap(pHeap, pHeap + size);
+
+				if (size == m_k)
+					worst = pHeap[0];
+			}
+		}
+	}
+
+	/* Sort every heap and convert the keys into packed Result words,
+	 * afterwards the output holds k results per query ordered by
+	 * ascending distance
+	 * */
+	void finish();
+
+private:
+	uint64_t* m_pOut;
+	size_t m_dynSize;
+	uint32_t m_k;
+	std::vector<uint8_t> m_sizes;
+};
@@ -22,178 +22,92 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 */
 
-#include <nmmintrin.h>
 #include <stdint.h>
-#ifdef _WIN32
-#include <intrin.h>
-#else
-#include <x86intrin.h>
-#endif
+#include <string.h>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 
+#include "Hash.h"
+#include "HashFile.h"
+#include "HexLoader.h"
+#include "TiledKernel.h"
+#include "PopcountBench.h"
+#include "ThresholdSink.h"
+#include "TopKSink.h"
+#include "EarlyAbortSearch.h"
+#include "MultiIndex.h"
+#include "PopcountBuckets.h"
 #include "Timer.h"
 
-typedef uint8_t byte;
-typedef std::vector<byte> bytes;
-
-
-typedef union
+// Per thread accumulator, padded to a cache line to avoid false sharing
+struct SumSink
 {
-	__m256i             value;
-	int8_t              m256i_i8[32];
-	int16_t             m256i_i16[16];
-	int32_t             m256i_i32[8];
-	int64_t             m256i_i64[4];
-	uint8_t             m256i_u8[32];
-	uint16_t            m256i_u16[16];
-	uint32_t            m256i_u32[8];
-	uint64_t            m256i_u64[4];
-} __m256i_c;
-
-struct hash
-{
-	union
+	struct alignas(64) Slot
 	{
-		uint8_t bytes[64];
-		uint64_t quadWords[8];
-		__m256i_c octaWords[2];
+		uint64_t sum;
+	};
 
-	} vals;
+	std::vector<Slot> slots;
 
-	hash operator^(const hash& h1)
+	SumSink(int threads) :
+		slots(threads)
 	{
-		hash res;
-		for (int i = 0; i < 64; i++)
-			res.vals.bytes[i] = this->vals.bytes[i] ^ h1.vals.bytes[i];
-
-		return res;
+		for (Slot& s : slots)
+			s.sum = 0;
 	}
 
-	friend std::ostream& operator<<(std::ostream& stream, const hash &h)
+	void operator()(int tid, size_t /*staticIdx*/, uint32_t rows, size_t /*dynIdx*/, uint32_t count, const uint16_t* pDist, uint32_t stride)
 	{
-		for (int i = 0; i < 64; i++)
-			stream << std::hex << std::setfill('0') << std::setw(2) << std::nouppercase << (int)h.vals.bytes[i];
-
-		return stream;
-	}
-};
-
-
-
-uint8_t popCnt8(uint8_t uc)
-{
-	uint8_t n;
-	n = ((uc >> 1) & 0x55) + (uc & 0x55);
-	n = ((n >> 2) & 0x33) + (n & 0x33);
-	return (n >> 4) + (n & 0x0f);
-}
-
-uint32_t popCnt512(hash n)
-{
-	uint32_t res = 0;
-
-	for (int i = 0; i < 64; i++)
-		res += popCnt8(n.vals.bytes[i]);
-
-	return res;
-}
+		uint64_t sum = 0;
 
+		for (uint32_t j = 0; j < count; j++)
+			for (uint32_t r = 0; r < rows; r++)
+				sum += pDist[j * stride + r];
 
-
-uint64_t popcount256(const uint64_t* u)
-{
-	return _mm_popcnt_u64(u[0]) + _mm_popcnt_u64(u[1]) + _mm_popcnt_u64(u[2]) + _mm_popcnt_u64(u[3]);
-}
-
-uint32_t hamming512(hash a, hash b)
-{
-	uint64_t res = 0;
-	__m256i_c v;
-	v.value = _mm256_xor_si256(a.vals.octaWords[0].value, b.vals.octaWords[0].value);
-	res += popcount256(v.m256i_u64);
-	v.value = _mm256_xor_si256(a.vals.octaWords[1].value, b.vals.octaWords[1].value);
-	res += popcount256(v.m256i_u64);
-	return (uint32_t)res;
-}
-
-struct Result
-{
-	uint64_t val;
-
-	uint16_t dist;
-	uint32_t idxB;
-	uint32_t idxA;
-
-	Result(uint64_t v)
-	{
-		val = v;
-		CalcValues();
+		slots[tid].sum += sum;
 	}
 
-	void CalcValues()
+	uint64_t total() const
 	{
-		dist = (uint16_t)val & 0x3FF;
-		idxB = (uint32_t)(val >> 10) & 0x7FFFFFF;
-		idxA = (uint32_t)(val >> 37) & 0x7FFFFFF;
-	}
+		uint64_t sum = 0;
+
+		for (const Slot& s : slots)
+			sum += s.sum;
 
+		return sum;
+	}
 };
 
-int fromHex(char _i)
-{
-	if (_i >= '0' && _i <= '9')
-		return _i - '0';
-	if (_i >= 'a' && _i <= 'f')
-		return _i - 'a' + 10;
-	if (_i >= 'A' && _i <= 'F')
-		return _i - 'A' + 10;
-
-	return -1;
-}
+static_assert(sizeof(hash) == HASH_FILE_RECORD_SIZE, "Mapped records are used as hash in place");
 
-bytes hexStringToBytes(std::string const& _s)
+/* Maps binary hash files in place, hex files are parsed into storage */
+bool loadHashes(const char* pFilename, HashFile& file, HashVector& storage, HashView& view)
 {
-	unsigned s = (_s[0] == '0' && _s[1] == 'x') ? 2 : 0;
-	std::vector<uint8_t> ret;
-	ret.reserve((_s.size() - s + 1) / 2);
+	if (HashFile::isHashFile(pFilename))
+	{
+		if (!file.open(pFilename))
+			return false;
 
-	if (_s.size() % 2)
+		view = HashView((const hash*)file.data(), file.size());
+	}
+	else
 	{
-		try
-		{
-			ret.push_back(fromHex(_s[s++]));
-		}
-		catch (...)
-		{
-			ret.push_back(0);
-		}
+		if (!readHexFile(pFilename, storage))
+			return false;
+
+		view = HashView(storage.data(), storage.size());
 	}
 
-	for (unsigned i = s; i < _s.size(); i += 2)
+	if (view.empty())
 	{
-		try
-		{
-			ret.push_back((byte)(fromHex(_s[i]) * 16 + fromHex(_s[i + 1])));
-		}
-		catch (...)
-		{
-			ret.push_back(0);
-		}
+		std::cout << "The input file " << pFilename << " does not contain any hashes." << std::endl;
+		return false;
 	}
 
-	return ret;
-}
-
-hash stringToHash(std::string const& _s)
-{
-	hash ret;
-	bytes b = hexStringToBytes(_s);
-	memcpy(&ret.vals.bytes, b.data(), b.size());
-	return ret;
+	return true;
 }
 
 std::string hps(double val)
@@ -247,36 +161,124 @@ std::string hps(double val)
 
 int main(int argc, char **argv)
 {
-	// --------- LOAD INPUT DATA ---------
-	Timer execTimer;
-	execTimer.start();
+	// Use the plain nested loop instead of the tiled kernel
+	bool naive = false;
+	const char* pKernelName = "auto";
+	// Report all pairs below the threshold instead of the distance sum, 0 = off
+	uint32_t threshold = 0;
+	// Use the prefix pruning kernel for the threshold search
+	bool earlyAbort = false;
+	// Use a multi-index hashing index for the threshold search, -1 = off, 0 = auto
+	int mihSubstrings = -1;
+	// Sort both sets into popcount buckets of this width and skip distant bucket pairs, 0 = off
+	uint32_t bucketWidth = 0;
+	// Report the k closest static hashes of every dynamic hash, 0 = off
+	uint32_t topK = 0;
+	const char* pOutputFile = nullptr;
+	// Hex text or binary hash files, see HashFile.h
+	const char* pStaticFile = "a.txt";
+	const char* pDynFile = "b_1m.txt";
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--naive") == 0)
+			naive = true;
+		else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc)
+			pKernelName = argv[++i];
+		else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+			threshold = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--early-abort") == 0)
+			earlyAbort = true;
+		else if (strcmp(argv[i], "--mih") == 0 && i + 1 < argc)
+			mihSubstrings = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--popcount-buckets") == 0 && i + 1 < argc)
+			bucketWidth = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--topk") == 0 && i + 1 < argc)
+			topK = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			pOutputFile = argv[++i];
+		else if (strcmp(argv[i], "--static") == 0 && i + 1 < argc)
+			pStaticFile = argv[++i];
+		else if (strcmp(argv[i], "--dynamic") == 0 && i + 1 < argc)
+			pDynFile = argv[++i];
+		else if (strcmp(argv[i], "--convert") == 0 && i + 2 < argc)
+		{
+			HashVector data;
+
+			if (!readHexFile(argv[i + 1], data) || !HashFile::write(argv[i + 2], data.data(), data.size()))
+				return -1;
+
+			printf("Converted %llu hashes from %s to %s\n", (unsigned long long)data.size(), argv[i + 1], argv[i + 2]);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-popcount") == 0)
+		{
+			runPopcountBenchmark();
+			return 0;
+		}
+		else
+		{
+			std::cout << "Usage: " << argv[0] << " [--naive] [--kernel auto|avx512|avx2-lut|avx2|scalar] [--threshold <dist> [--early-abort | --mih <0|8|16|32|64> | --popcount-buckets <width>] | --topk <k>] [--output <file>] [--static <file>] [--dynamic <file>] [--convert <hex-file> <hash-file>] [--bench-popcount]" << std::endl;
+			return -1;
+		}
+	}
 
-	std::vector<hash> staticData;
-	std::vector<hash> dynData;
+	const HammingKernel* pKernel = selectKernel(pKernelName);
 
-	std::ifstream infile("a.txt");
+	if (pKernel == nullptr)
+	{
+		std::cout << "Kernel \"" << pKernelName << "\" is unknown or not supported by this CPU." << std::endl;
+		return -1;
+	}
 
-	if (!infile.is_open())
+	printf("Kernel: %s\n", pKernel->pName);
+
+	if (threshold > 0x3FF || (threshold > 0 && naive))
 	{
-		std::cout << "Error while opening the input file. Current Directory: " << system("dir") << std::endl;
+		std::cout << "The threshold has to be below 1024 and can not be combined with --naive." << std::endl;
 		return -1;
 	}
 
-	std::string s;
-	while (infile >> s)
-		staticData.push_back(stringToHash(s));
+	if (earlyAbort && threshold == 0)
+	{
+		std::cout << "--early-abort requires --threshold." << std::endl;
+		return -1;
+	}
 
-	infile.close();
-	infile.open("b_1m.txt");
+	if (mihSubstrings >= 0 && (threshold == 0 || earlyAbort || (mihSubstrings != 0 && (mihSubstrings < 8 || mihSubstrings > 64 || (mihSubstrings & (mihSubstrings - 1))))))
+	{
+		std::cout << "--mih requires --threshold, can not be combined with --early-abort and takes 0 (auto), 8, 16, 32 or 64 substrings." << std::endl;
+		return -1;
+	}
+
+	if (bucketWidth > 0 && (threshold == 0 || earlyAbort || mihSubstrings >= 0 || bucketWidth > 512))
+	{
+		std::cout << "--popcount-buckets requires --threshold, can not be combined with --early-abort or --mih and takes a width of 1 to 512." << std::endl;
+		return -1;
+	}
 
-	if (!infile.is_open())
+	if (topK > MAX_TOP_K || (topK > 0 && (naive || threshold > 0)))
 	{
-		std::cout << "Error while opening the input file. Current Directory: " << system("dir") << std::endl;
+		std::cout << "k has to be between 1 and " << MAX_TOP_K << " and can not be combined with --naive or --threshold." << std::endl;
 		return -1;
 	}
 
-	while (infile >> s)
-		dynData.push_back(stringToHash(s));
+	// Both modes produce packed Result words
+	const bool resultMode = threshold > 0 || topK > 0;
+
+	// --------- LOAD INPUT DATA ---------
+	Timer execTimer;
+	execTimer.start();
+
+	HashVector staticStorage;
+	HashVector dynStorage;
+	HashFile staticFile;
+	HashFile dynFile;
+	HashView staticData;
+	HashView dynData;
+
+	if (!loadHashes(pStaticFile, staticFile, staticStorage, staticData) || !loadHashes(pDynFile, dynFile, dynStorage, dynData))
+		return -1;
 
 	printf("---Static Data(%llu)---\nFirst: ", staticData.size());
 
@@ -307,32 +309,215 @@ int main(int argc, char **argv)
 
 	// --------- LOAD INPUT DATA ---------
 
+	if (resultMode && (staticData.size() > MAX_RESULT_INDEX + 1 || dynData.size() > MAX_RESULT_INDEX + 1))
+	{
+		std::cout << "Too many hashes, the indices do not fit into the 27 bit fields of a result." << std::endl;
+		return -1;
+	}
+
 	uint64_t bla = 0;
+	ResultVector results;
+	PruneStats pruneStats = { 0, 0, 0 };
+	MultiIndexStats mihStats = { 0, 0, 0 };
+	BucketStats bucketStats = { 0, 0, 0 };
+
+	MultiIndex* pIndex = nullptr;
+	PopcountBuckets* pStaticBuckets = nullptr;
+	PopcountBuckets* pDynBuckets = nullptr;
+
+	if (bucketWidth)
+	{
+		execTimer.start();
+		pStaticBuckets = new PopcountBuckets(staticData.data(), staticData.size(), bucketWidth);
+		pDynBuckets = new PopcountBuckets(dynData.data(), dynData.size(), bucketWidth);
+		execTimer.stop();
+
+		printf("Popcount bucketing time: %0.3f ms\n", execTimer.getElapsedTimeInMilliSec());
+	}
+
+	if (mihSubstrings == 0)
+	{
+		mihSubstrings = MultiIndex::chooseSubstrings(staticData.size(), threshold);
+
+		if (mihSubstrings == 0)
+		{
+			printf("Multi-index hashing does not pay off for a threshold of %u, scanning the static set\n", threshold);
+			mihSubstrings = -1;
+		}
+	}
+	else if (mihSubstrings > 0 && MultiIndex::probesPerQuery(mihSubstrings, threshold) > staticData.size())
+	{
+		// The keys within the radius outnumber the static hashes
+		printf("%d substrings need %0.0f probes per query for a threshold of %u, scanning the static set\n", mihSubstrings, MultiIndex::probesPerQuery(mihSubstrings, threshold), threshold);
+		mihSubstrings = -1;
+	}
+
+	if (mihSubstrings > 0)
+	{
+		execTimer.start();
+		pIndex = new MultiIndex(staticData.data(), staticData.size(), mihSubstrings);
+		execTimer.stop();
+
+		printf("Index build time (%d substrings, search radius %u per table): %0.3f ms\n", mihSubstrings, (threshold - 1) / mihSubstrings, execTimer.getElapsedTimeInMilliSec());
+	}
 
 	execTimer.start();
-	int i;
 
-#pragma omp parallel shared(bla) private(i)
+	if (threshold)
 	{
-#pragma omp for schedule(dynamic)
-		for (i = 0; i < dynData.size(); i++)
+		TileShape shape = calcTileShape();
+		ThresholdSink sink(maxThreads(), threshold);
+
+		if (pIndex)
+			multiIndexSearch(*pIndex, dynData.data(), dynData.size(), threshold, sink, mihStats);
+		else if (earlyAbort)
+			earlyAbortSearch(staticData.data(), staticData.size(), dynData.data(), dynData.size(), threshold, shape, sink, pruneStats);
+		else if (pStaticBuckets)
+			bucketedThresholdSearch(*pKernel, *pStaticBuckets, *pDynBuckets, threshold, shape, sink, bucketStats);
+		else
+			tiledAllPairs(*pKernel, staticData.data(), staticData.size(), dynData.data(), dynData.size(), shape, sink);
+
+		if (pStaticBuckets)
+			results = sink.merge(pStaticBuckets->index.data(), pDynBuckets->index.data());
+		else
+			results = sink.merge();
+	}
+	else if (topK)
+	{
+		// Dense array, k results per dynamic hash
+		TileShape shape = calcTileShape();
+		results.resize(dynData.size() * topK);
+		TopKSink sink(dynData.size(), topK, results.data());
+
+		tiledAllPairs(*pKernel, staticData.data(), staticData.size(), dynData.data(), dynData.size(), shape, sink);
+		sink.finish();
+	}
+	else if (naive)
+	{
+		const PairKernel pair = pKernel->pair;
+		int i;
+
+#pragma omp parallel for schedule(dynamic) private(i) reduction(+:bla)
+		for (i = 0; i < (int)dynData.size(); i++)
 		{
-			for (int j = 0; j < staticData.size(); j++)
+			for (int j = 0; j < (int)staticData.size(); j++)
 			{
 				// Just add up the results to prevent the compiler from
 				// removing everything
-				bla += hamming512(staticData.at(j), dynData.at(i));
+				bla += pair(staticData.at(j), dynData.at(i));
 			}
 		}
 	}
+	else if (pKernel->sum)
+	{
+		// No per pair distances needed, let the kernel accumulate an
+		// L1-sized tile of dynamic hashes per static hash
+		const TileShape shape = calcTileShape();
+		const int tiles = (int)((dynData.size() + shape.dynTile - 1) / shape.dynTile);
+		const SumKernel sum = pKernel->sum;
+		int t;
+
+#pragma omp parallel for schedule(dynamic) private(t) reduction(+:bla)
+		for (t = 0; t < tiles; t++)
+		{
+			const size_t d = (size_t)t * shape.dynTile;
+			const uint32_t count = (uint32_t)std::min((size_t)shape.dynTile, dynData.size() - d);
+
+			for (size_t j = 0; j < staticData.size(); j++)
+				bla += sum(staticData[j], &dynData[d], count);
+		}
+	}
+	else
+	{
+		TileShape shape = calcTileShape();
+		printf("Tile shape: %u static x %u dynamic (%u per group)\n", shape.staticTile, shape.dynTile, shape.dynGroup);
+
+		SumSink sink(maxThreads());
+		tiledAllPairs(*pKernel, staticData.data(), staticData.size(), dynData.data(), dynData.size(), shape, sink);
+		bla = sink.total();
+	}
 
 	execTimer.stop();
 
+	delete pIndex;
+	delete pStaticBuckets;
+	delete pDynBuckets;
+
 	printf("Compute time: %0.3f ms\n", execTimer.getElapsedTimeInMilliSec());
 	printf("Hashes per second: %s\n", hps((staticData.size() * dynData.size()) / (execTimer.getElapsedTimeInMilliSec() / 1000.0)).c_str());
 
-	// Print the add up result to prevent compiler stuff
-	printf("res: %llu\n", bla);
+	if (!resultMode)
+	{
+		// Print the add up result to prevent compiler stuff
+		printf("res: %llu\n", bla);
+		return 0;
+	}
+
+	std::cout << "Final Count: " << results.size() << std::endl;
+
+	if (earlyAbort && pruneStats.pairs)
+	{
+		const double pairs = (double)pruneStats.pairs;
+		const uint64_t full = pruneStats.pairs - pruneStats.pruned128 - pruneStats.pruned256;
+
+		printf("Pruned after 128 bits: %0.3f %%\n", 100.0 * pruneStats.pruned128 / pairs);
+		printf("Pruned after 256 bits: %0.3f %%\n", 100.0 * pruneStats.pruned256 / pairs);
+		printf("Full 512 bit compares: %0.3f %%\n", 100.0 * full / pairs);
+	}
+
+	if (bucketStats.bucketPairs)
+	{
+		printf("Skipped bucket pairs: %llu of %llu\n", (unsigned long long)bucketStats.skippedBucketPairs, (unsigned long long)bucketStats.bucketPairs);
+		printf("Skipped hash pairs: %0.3f %%\n", 100.0 * bucketStats.skippedPairs / ((double)staticData.size() * dynData.size()));
+	}
+
+	if (mihStats.queries)
+	{
+		printf("Table probes per query: %0.3f\n", (double)mihStats.probes / mihStats.queries);
+		printf("Candidates per query: %0.3f (%0.5f %% of the static set)\n", (double)mihStats.candidates / mihStats.queries, 100.0 * mihStats.candidates / ((double)mihStats.queries * staticData.size()));
+	}
+
+	execTimer.start();
+
+	int missCnt = 0;
+	int matchCnt = 0;
+	int skipCnt = 0;
+
+	for (uint64_t v : results)
+	{
+		Result r(v);
+
+		// Empty top-k slots
+		if (r.idxA >= staticData.size() || r.idxB >= dynData.size())
+		{
+			skipCnt++;
+			continue;
+		}
+
+		if (popCnt512(staticData.at(r.idxA) ^ dynData.at(r.idxB)) != r.dist)
+			missCnt++;
+		else
+			matchCnt++;
+	}
+
+	execTimer.stop();
+
+	std::cout << std::endl << "Skips: " << std::dec << skipCnt << std::endl << "Misses: " << missCnt << std::endl << "Matches: " << matchCnt << std::endl;
+	printf("CPU compare time: %0.3f ms\n", execTimer.getElapsedTimeInMilliSec());
+
+	if (pOutputFile)
+	{
+		// Raw 64 bit Result words, the same as read back from the OpenCL device
+		std::ofstream outfile(pOutputFile, std::ios::binary);
+
+		if (!outfile.is_open())
+		{
+			std::cout << "Error while opening the output file " << pOutputFile << std::endl;
+			return -1;
+		}
+
+		outfile.write((const char*)results.data(), results.size() * sizeof(uint64_t));
+	}
 
 	return 0;
 }
\ No newline at end of file
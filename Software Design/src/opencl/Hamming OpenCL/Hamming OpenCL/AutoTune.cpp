@@ -0,0 +1,280 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "AutoTune.h"
+#include "oclErrorCodes.h"
+#include "hamming.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define TUNE_HASH_SIZE 64
+
+static void check(cl_int err, const char* pWhat)
+{
+	if (err != CL_SUCCESS)
+	{
+		printf("Error: %s failed: %s\n", pWhat, oclErrorCode(err));
+		exit(EXIT_FAILURE);
+	}
+}
+
+bool loadWorkSizes(const char* pTuneFile, unsigned long long key, const char* pKernel, WorkSizes& sizes)
+{
+	std::ifstream file(pTuneFile);
+	std::string line;
+
+	// One line per configuration: <key> <kernel> <global> <local> <chunk> <depth>
+	while (std::getline(file, line))
+	{
+		unsigned long long lineKey;
+		char kernel[128];
+		WorkSizes s;
+
+		if (sscanf(line.c_str(), "%llx %127s %zu %zu %zu %zu", &lineKey, kernel, &s.global, &s.local, &s.chunk, &s.depth) != 6)
+			continue;
+
+		if (lineKey == key && strcmp(kernel, pKernel) == 0 && s.global > 0 && s.local > 0 && s.global % s.local == 0 && s.chunk > 0 && s.depth > 0)
+		{
+			sizes = s;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void storeWorkSizes(const char* pTuneFile, unsigned long long key, const char* pKernel, const WorkSizes& sizes)
+{
+	std::vector<std::string> lines;
+	std::ifstream in(pTuneFile);
+	std::string line;
+
+	while (std::getline(in, line))
+	{
+		unsigned long long lineKey;
+		char kernel[128];
+
+		if (sscanf(line.c_str(), "%llx %127s", &lineKey, kernel) == 2 && lineKey == key && strcmp(kernel, pKernel) == 0)
+			continue;
+
+		lines.push_back(line);
+	}
+
+	in.close();
+
+	char entry[256];
+	snprintf(entry, sizeof(entry), "%016llx %s %zu %zu %zu %zu", key, pKernel, sizes.global, sizes.local, sizes.chunk, sizes.depth);
+	lines.push_back(entry);
+
+	std::ofstream out(pTuneFile, std::ios::trunc);
+
+	for (const std::string& l : lines)
+		out << l << "\n";
+
+	if (!out)
+		printf("Warning: Could not store the tuned work sizes in %s\n", pTuneFile);
+}
+
+static cl_ulong profilingInfo(cl_event event, cl_profiling_info param)
+{
+	cl_ulong time = 0;
+	clGetEventProfilingInfo(event, param, sizeof(cl_ulong), &time, NULL);
+	return time;
+}
+
+/* Device time in ps per pair of streaming chunks of the dynamic data
+ * through depth buffers, with the same dependencies as the host pipeline
+ * */
+static double measure(const TuneContext& ctx, cl_command_queue queue, cl_mem staticBuffer, const WorkSizes& s)
+{
+	const size_t chunks = std::max<size_t>(4 * s.depth, 8);
+	const size_t sample = std::min(ctx.dynCount, chunks * s.chunk);
+	const cl_uint zero[2] = { 0, 0 };
+	const cl_uint threshold = 0;
+	const cl_uint capacity = 1;
+	cl_int err;
+
+	cl_mem output = clCreateBuffer(ctx.world.context, CL_MEM_WRITE_ONLY, sizeof(cl_ulong), NULL, &err);
+	check(err, "clCreateBuffer");
+	cl_mem state = clCreateBuffer(ctx.world.context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(zero), (void*) zero, &err);
+	check(err, "clCreateBuffer");
+
+	std::vector<cl_mem> dynBuffers(s.depth);
+
+	for (cl_mem& b : dynBuffers)
+	{
+		b = clCreateBuffer(ctx.world.context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, s.chunk * TUNE_HASH_SIZE, NULL, &err);
+		check(err, "clCreateBuffer");
+	}
+
+	xcl_set_kernel_arg(ctx.krnl, 0, sizeof(cl_mem), &output);
+	xcl_set_kernel_arg(ctx.krnl, 1, sizeof(cl_mem), &staticBuffer);
+	xcl_set_kernel_arg(ctx.krnl, 5, sizeof(cl_uint), &threshold);
+	xcl_set_kernel_arg(ctx.krnl, 6, sizeof(cl_mem), &state);
+
+	if (ctx.ndrange)
+	{
+		const cl_uint seqALength = (cl_uint) ctx.staticCount;
+		xcl_set_kernel_arg(ctx.krnl, 7, sizeof(cl_uint), &seqALength);
+		xcl_set_kernel_arg(ctx.krnl, 8, sizeof(cl_uint), &zero[0]);
+		xcl_set_kernel_arg(ctx.krnl, 9, ctx.staticCount * TUNE_HASH_SIZE, NULL);
+		xcl_set_kernel_arg(ctx.krnl, 10, sizeof(cl_uint), &capacity);
+		xcl_set_kernel_arg(ctx.krnl, 11, sizeof(cl_uint), &zero[0]);
+		xcl_set_kernel_arg(ctx.krnl, 12, sizeof(cl_uint), &zero[0]);
+	}
+	else
+	{
+		xcl_set_kernel_arg(ctx.krnl, 7, sizeof(cl_uint), &capacity);
+		xcl_set_kernel_arg(ctx.krnl, 8, sizeof(cl_uint), &zero[0]);
+	}
+
+	std::vector<cl_event> writes;
+	std::vector<cl_event> kernels;
+
+	for (size_t offset = 0; offset < sample; offset += s.chunk)
+	{
+		const size_t slot = writes.size() % s.depth;
+		const cl_uint seqBLength = (cl_uint) std::min(s.chunk, sample - offset);
+		const cl_uint seqBOffset = (cl_uint) offset;
+
+		// A buffer is refilled once the kernel of the chunk depth chunks ago is done
+		cl_event write;
+		const bool reuse = kernels.size() >= s.depth;
+		check(clEnqueueWriteBuffer(queue, dynBuffers[slot], CL_FALSE, 0, seqBLength * TUNE_HASH_SIZE, (const char*) ctx.pDyn + offset * TUNE_HASH_SIZE, reuse ? 1 : 0, reuse ? &kernels[kernels.size() - s.depth] : NULL, &write), "clEnqueueWriteBuffer");
+
+		xcl_set_kernel_arg(ctx.krnl, 2, sizeof(cl_mem), &dynBuffers[slot]);
+		xcl_set_kernel_arg(ctx.krnl, 3, sizeof(cl_uint), &seqBLength);
+		xcl_set_kernel_arg(ctx.krnl, 4, sizeof(cl_uint), &seqBOffset);
+
+		cl_event kernel;
+		check(clEnqueueNDRangeKernel(queue, ctx.krnl, 1, NULL, &s.global, &s.local, 1, &write, &kernel), "clEnqueueNDRangeKernel");
+
+		writes.push_back(write);
+		kernels.push_back(kernel);
+	}
+
+	check(clFinish(queue), "clFinish");
+
+	cl_ulong start = profilingInfo(writes.front(), CL_PROFILING_COMMAND_START);
+	cl_ulong end = 0;
+
+	for (size_t i = 0; i < writes.size(); i++)
+	{
+		start = std::min(start, profilingInfo(writes[i], CL_PROFILING_COMMAND_START));
+		end = std::max(end, profilingInfo(kernels[i], CL_PROFILING_COMMAND_END));
+		clReleaseEvent(writes[i]);
+		clReleaseEvent(kernels[i]);
+	}
+
+	for (cl_mem b : dynBuffers)
+		clReleaseMemObject(b);
+
+	clReleaseMemObject(state);
+	clReleaseMemObject(output);
+
+	const size_t compared = ctx.ndrange ? ctx.staticCount : SEQ_A_SIZE;
+	return end > start ? (double) (end - start) * 1000.0 / ((double) sample * compared) : 0.0;
+}
+
+WorkSizes tuneWorkSizes(const TuneContext& ctx)
+{
+	cl_int err;
+	cl_command_queue queue = clCreateCommandQueue(ctx.world.context, ctx.world.device_id, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_PROFILING_ENABLE, &err);
+	check(err, "clCreateCommandQueue");
+
+	const size_t staticBytes = (ctx.ndrange ? ctx.staticCount : SEQ_A_SIZE) * TUNE_HASH_SIZE;
+	cl_mem staticBuffer = clCreateBuffer(ctx.world.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, staticBytes, (void*) ctx.pStatic, &err);
+	check(err, "clCreateBuffer");
+
+	WorkSizes best = { 1, 1, SEQ_A_SIZE, 2 };
+	double bestTime = 0.0;
+
+	auto consider = [&](const WorkSizes& s)
+	{
+		const double time = measure(ctx, queue, staticBuffer, s);
+		printf("Tuning: global %zu local %zu chunk %zu depth %zu: %0.3f ps per pair\n", s.global, s.local, s.chunk, s.depth, time);
+
+		if (time > 0.0 && (bestTime == 0.0 || time < bestTime))
+		{
+			best = s;
+			bestTime = time;
+		}
+	};
+
+	if (ctx.ndrange)
+	{
+		cl_uint computeUnits = 1;
+		size_t maxLocal = 1;
+		size_t kernelLocal = 1;
+		clGetDeviceInfo(ctx.world.device_id, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &computeUnits, NULL);
+		clGetDeviceInfo(ctx.world.device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &maxLocal, NULL);
+
+		if (clGetKernelWorkGroupInfo(ctx.krnl, ctx.world.device_id, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &kernelLocal, NULL) == CL_SUCCESS)
+			maxLocal = std::min(maxLocal, kernelLocal);
+
+		maxLocal = std::max<size_t>(maxLocal, 1);
+		computeUnits = std::max<cl_uint>(computeUnits, 1);
+
+		// One dynamic hash per work item while the grid is tuned
+		for (size_t local = std::min<size_t>(16, maxLocal); local <= maxLocal; local *= 2)
+		{
+			for (size_t groups = 1; groups <= 8; groups *= 2)
+			{
+				const size_t global = computeUnits * local * groups;
+				consider({ global, local, global, 2 });
+			}
+		}
+
+		const size_t global = best.global;
+
+		for (size_t factor = 4; factor <= 16; factor *= 4)
+			consider({ global, best.local, global * factor, 2 });
+	}
+	else
+	{
+		// hamming_dist stages a whole chunk in local memory and runs as a single work item
+		for (size_t chunk = SEQ_A_SIZE / 4; chunk <= SEQ_A_SIZE; chunk *= 2)
+			consider({ 1, 1, chunk, 2 });
+	}
+
+	const WorkSizes grid = best;
+
+	for (size_t depth = 1; depth <= 8; depth *= 2)
+	{
+		if (depth != grid.depth)
+			consider({ grid.global, grid.local, grid.chunk, depth });
+	}
+
+	clReleaseMemObject(staticBuffer);
+	clReleaseCommandQueue(queue);
+
+	return best;
+}
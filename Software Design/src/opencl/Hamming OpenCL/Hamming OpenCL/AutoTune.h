@@ -0,0 +1,71 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "xcl.h"
+
+/* Work sizes of a run */
+struct WorkSizes
+{
+	size_t global;
+	size_t local;
+	size_t chunk; // Dynamic hashes per chunk
+	size_t depth; // Chunks in flight
+};
+
+/* Device, kernel and data the autotuner measures with. The static and
+ * dynamic data are 512 bit hashes, only the first staticCount static
+ * hashes are compared, so this should be one static tile.
+ * */
+struct TuneContext
+{
+	xcl_world world;
+	cl_kernel krnl;
+	bool ndrange;
+	const void* pStatic;
+	size_t staticCount;
+	const void* pDyn;
+	size_t dynCount;
+};
+
+/* Looks up the work sizes stored for the kernel and key (see
+ * xcl_source_key) in pTuneFile, returns false if there are none
+ * */
+bool loadWorkSizes(const char* pTuneFile, unsigned long long key, const char* pKernel, WorkSizes& sizes);
+
+/* Stores the work sizes for the kernel and key in pTuneFile, replacing
+ * earlier ones
+ * */
+void storeWorkSizes(const char* pTuneFile, unsigned long long key, const char* pKernel, const WorkSizes& sizes);
+
+/* Sweeps the work group size and global size, then the chunk size and
+ * then the pipeline depth, each with the best values found so far. Every
+ * candidate streams a few chunks with a threshold of 0, so there are no
+ * results, and is rated by the device time per pair from the profiling
+ * info of its first write to its last kernel.
+ * */
+WorkSizes tuneWorkSizes(const TuneContext& ctx);
@@ -0,0 +1,224 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "HashFile.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+#ifdef _WIN32
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr),
+#else
+	m_fd(-1),
+#endif
+	m_pBase(nullptr),
+	m_length(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const char* pFilename)
+{
+	close();
+
+#ifdef _WIN32
+	m_file = CreateFileA(pFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "Error while opening the input file " << pFilename << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(m_file, &size);
+	m_length = (size_t)size.QuadPart;
+
+	if (m_length == 0)
+		return true;
+
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (m_mapping != nullptr)
+		m_pBase = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	m_fd = ::open(pFilename, O_RDONLY);
+
+	if (m_fd < 0)
+	{
+		std::cout << "Error while opening the input file " << pFilename << std::endl;
+		return false;
+	}
+
+	struct stat st;
+	fstat(m_fd, &st);
+	m_length = (size_t)st.st_size;
+
+	if (m_length == 0)
+		return true;
+
+	m_pBase = mmap(nullptr, m_length, PROT_READ, MAP_SHARED, m_fd, 0);
+
+	if (m_pBase == MAP_FAILED)
+		m_pBase = nullptr;
+	else
+		madvise(m_pBase, m_length, MADV_WILLNEED);
+#endif
+
+	if (m_pBase == nullptr)
+	{
+		std::cout << "Error while mapping the input file " << pFilename << std::endl;
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (m_pBase)
+		UnmapViewOfFile(m_pBase);
+
+	if (m_mapping)
+		CloseHandle(m_mapping);
+
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = nullptr;
+#else
+	if (m_pBase)
+		munmap(m_pBase, m_length);
+
+	if (m_fd >= 0)
+		::close(m_fd);
+
+	m_fd = -1;
+#endif
+	m_pBase = nullptr;
+	m_length = 0;
+}
+
+HashFile::HashFile() :
+	m_pData(nullptr),
+	m_count(0)
+{
+}
+
+bool HashFile::isHashFile(const char* pFilename)
+{
+	char magic[8];
+	FILE* pFile = fopen(pFilename, "rb");
+
+	if (pFile == nullptr)
+		return false;
+
+	const bool res = fread(magic, 1, sizeof(magic), pFile) == sizeof(magic) && memcmp(magic, HASH_FILE_MAGIC, sizeof(magic)) == 0;
+
+	fclose(pFile);
+	return res;
+}
+
+bool HashFile::open(const char* pFilename)
+{
+	close();
+
+	if (!m_file.open(pFilename))
+		return false;
+
+	const size_t length = m_file.size();
+	const HashFileHeader* pHeader = (const HashFileHeader*)m_file.data();
+
+	if (length < sizeof(HashFileHeader) || memcmp(pHeader->magic, HASH_FILE_MAGIC, sizeof(pHeader->magic)) != 0 || pHeader->bits != 512
+		|| pHeader->alignment == 0 || pHeader->dataOffset % pHeader->alignment != 0 || pHeader->dataOffset % HASH_FILE_ALIGNMENT != 0
+		|| pHeader->dataOffset > length || pHeader->count > (length - pHeader->dataOffset) / HASH_FILE_RECORD_SIZE)
+	{
+		std::cout << "Invalid or truncated hash file " << pFilename << std::endl;
+		close();
+		return false;
+	}
+
+	m_pData = m_file.data() + pHeader->dataOffset;
+	m_count = (size_t)pHeader->count;
+
+	return true;
+}
+
+void HashFile::close()
+{
+	m_file.close();
+	m_pData = nullptr;
+	m_count = 0;
+}
+
+bool HashFile::write(const char* pFilename, const void* pData, size_t count)
+{
+	FILE* pFile = fopen(pFilename, "wb");
+
+	if (pFile == nullptr)
+	{
+		std::cout << "Error while creating the hash file " << pFilename << std::endl;
+		return false;
+	}
+
+	HashFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, HASH_FILE_MAGIC, sizeof(header.magic));
+	header.count = count;
+	header.bits = 512;
+	header.alignment = HASH_FILE_ALIGNMENT;
+	header.dataOffset = sizeof(HashFileHeader);
+
+	bool res = fwrite(&header, sizeof(header), 1, pFile) == 1;
+
+	if (res && count > 0)
+		res = fwrite(pData, HASH_FILE_RECORD_SIZE, count, pFile) == count;
+
+	if (fclose(pFile) != 0)
+		res = false;
+
+	if (!res)
+		std::cout << "Error while writing the hash file " << pFilename << std::endl;
+
+	return res;
+}
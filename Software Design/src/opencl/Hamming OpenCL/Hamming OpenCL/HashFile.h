@@ -0,0 +1,109 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HASH_FILE_MAGIC "HASHBIN1"
+#define HASH_FILE_ALIGNMENT 64
+#define HASH_FILE_RECORD_SIZE 64
+
+/* Binary hash container, the 64 byte header is followed by count raw
+ * 512 bit hash records starting at dataOffset. dataOffset and the record size
+ * are multiples of alignment, so a mapping of the file can be used in
+ * place without any parsing or copying.
+ * */
+struct HashFileHeader
+{
+	char magic[8];       // HASH_FILE_MAGIC, not zero terminated
+	uint64_t count;      // Number of records
+	uint32_t bits;       // Bits per record, 512
+	uint32_t alignment;  // Alignment of the records in bytes
+	uint64_t dataOffset; // Offset of the first record in bytes
+	uint8_t reserved[32];
+};
+
+static_assert(sizeof(HashFileHeader) == HASH_FILE_ALIGNMENT, "The header has to fill exactly one alignment unit");
+
+/* Read only memory mapping of a whole file */
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/* Prints the reason and returns false on failure, an empty file is
+	 * mapped with size 0
+	 * */
+	bool open(const char* pFilename);
+	void close();
+
+	const uint8_t* data() const { return (const uint8_t*)m_pBase; }
+	size_t size() const { return m_length; }
+
+private:
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_fd;
+#endif
+	void* m_pBase;
+	size_t m_length;
+};
+
+/* Read only memory mapping of a hash file */
+class HashFile
+{
+public:
+	HashFile();
+
+	/* True if the file starts with HASH_FILE_MAGIC */
+	static bool isHashFile(const char* pFilename);
+
+	/* Maps the file and validates its header, prints the reason and
+	 * returns false on failure
+	 * */
+	bool open(const char* pFilename);
+	void close();
+
+	/* Start of the records, aligned to HASH_FILE_ALIGNMENT bytes */
+	const void* data() const { return m_pData; }
+	size_t size() const { return m_count; }
+
+	/* Writes count records of HASH_FILE_RECORD_SIZE bytes as hash file,
+	 * returns false on failure
+	 * */
+	static bool write(const char* pFilename, const void* pData, size_t count);
+
+private:
+	MappedFile m_file;
+	const void* m_pData;
+	size_t m_count;
+};
@@ -0,0 +1,211 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "Trace.h"
+
+#include <stdio.h>
+#include <fstream>
+
+static std::string escape(const std::string& s)
+{
+	std::string res;
+
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+			res.push_back('\\');
+
+		if ((unsigned char) c >= 0x20)
+			res.push_back(c);
+	}
+
+	return res;
+}
+
+Trace::Trace(bool enabled) :
+		m_enabled(enabled), m_start(std::chrono::steady_clock::now())
+{
+}
+
+Trace::~Trace()
+{
+	for (Span& s : m_spans)
+	{
+		if (s.event)
+			clReleaseEvent(s.event);
+	}
+
+	for (Calibration& c : m_calibrations)
+		clReleaseEvent(c.event);
+}
+
+double Trace::now() const
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void Trace::nameProcess(uint32_t pid, const std::string& name)
+{
+	if (!m_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_names.push_back("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"args\":{\"name\":\"" + escape(name) + "\"}}");
+}
+
+void Trace::nameThread(uint32_t pid, uint32_t tid, const std::string& name)
+{
+	if (!m_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_names.push_back("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(tid) + ",\"args\":{\"name\":\"" + escape(name) + "\"}}");
+
+	// Keep the tracks in the order of their ids instead of their names
+	m_names.push_back("{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(tid) + ",\"args\":{\"sort_index\":" + std::to_string(tid) + "}}");
+}
+
+void Trace::hostSpan(uint32_t pid, uint32_t tid, const char* pName, double startUs, double endUs, const std::string& args)
+{
+	if (!m_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_spans.push_back(Span { pid, tid, pName, "host", startUs, endUs, args, NULL });
+}
+
+void Trace::calibrate(uint32_t pid, cl_event event, double hostUs)
+{
+	if (!m_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	clRetainEvent(event);
+	m_calibrations.push_back(Calibration { pid, event, hostUs });
+}
+
+void Trace::command(uint32_t pid, uint32_t tid, cl_event event, const char* pName, const char* pCategory, const std::string& args)
+{
+	if (!m_enabled || event == NULL)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	clRetainEvent(event);
+	m_spans.push_back(Span { pid, tid, pName, pCategory, 0.0, 0.0, args, event });
+}
+
+void Trace::resolve()
+{
+	if (!m_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (const Calibration& c : m_calibrations)
+	{
+		cl_ulong queued = 0;
+		clWaitForEvents(1, &c.event);
+
+		if (clGetEventProfilingInfo(c.event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &queued, NULL) == CL_SUCCESS)
+			m_offsets[c.pid] = c.hostUs - queued / 1000.0;
+
+		clReleaseEvent(c.event);
+	}
+
+	m_calibrations.clear();
+
+	for (Span& s : m_spans)
+	{
+		if (s.event == NULL)
+			continue;
+
+		cl_ulong start = 0;
+		cl_ulong end = 0;
+		clWaitForEvents(1, &s.event);
+		clGetEventProfilingInfo(s.event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+		clGetEventProfilingInfo(s.event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+		clReleaseEvent(s.event);
+		s.event = NULL;
+
+		// Commands without profiling info are left out by write
+		s.startUs = m_offsets[s.pid] + start / 1000.0;
+		s.endUs = end >= start && end != 0 ? m_offsets[s.pid] + end / 1000.0 : -1.0;
+	}
+}
+
+bool Trace::write(const char* pFilename)
+{
+	if (!m_enabled)
+		return true;
+
+	resolve();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::ofstream out(pFilename);
+
+	if (!out.is_open())
+	{
+		printf("Error while opening the trace file %s\n", pFilename);
+		return false;
+	}
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool first = true;
+
+	for (const std::string& name : m_names)
+	{
+		out << (first ? "" : ",\n") << name;
+		first = false;
+	}
+
+	char times[64];
+
+	for (const Span& s : m_spans)
+	{
+		if (s.endUs < s.startUs)
+			continue;
+
+		snprintf(times, sizeof(times), "\"ts\":%0.3f,\"dur\":%0.3f", s.startUs, s.endUs - s.startUs);
+
+		out << (first ? "" : ",\n") << "{\"name\":\"" << escape(s.name) << "\",\"cat\":\"" << s.category << "\",\"ph\":\"X\",\"pid\":" << s.pid << ",\"tid\":" << s.tid << "," << times;
+
+		if (!s.args.empty())
+			out << ",\"args\":" << s.args;
+
+		out << "}";
+		first = false;
+	}
+
+	out << "\n]}\n";
+
+	if (!out.good())
+	{
+		printf("Error while writing the trace file %s\n", pFilename);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,111 @@
+/*
+The MIT License
+
+Copyright (c) 2017 Florian Porrmann
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <CL/opencl.h>
+
+/* Timeline of a run in the Chrome trace event format, it can be opened in
+ * chrome://tracing or ui.perfetto.dev. Host spans are taken with the clock
+ * of the trace. Device commands are taken from their profiling info and
+ * shifted onto the host clock with one calibration command per device.
+ * Every process (pid) is a device or the host, every thread (tid) a track
+ * of it. A disabled trace records nothing.
+ * */
+class Trace
+{
+public:
+	explicit Trace(bool enabled);
+	~Trace();
+
+	Trace(const Trace&) = delete;
+	Trace& operator=(const Trace&) = delete;
+
+	bool enabled() const { return m_enabled; }
+
+	/* Microseconds since the trace was created */
+	double now() const;
+
+	void nameProcess(uint32_t pid, const std::string& name);
+	void nameThread(uint32_t pid, uint32_t tid, const std::string& name);
+
+	/* Records a host span, args is a JSON object or empty */
+	void hostSpan(uint32_t pid, uint32_t tid, const char* pName, double startUs, double endUs, const std::string& args = "");
+
+	/* Aligns the device clock of pid with the host clock, hostUs is the
+	 * time right before the command of the event was enqueued
+	 * */
+	void calibrate(uint32_t pid, cl_event event, double hostUs);
+
+	/* Records a device command, the event is retained until resolve. args
+	 * is a JSON object or empty.
+	 * */
+	void command(uint32_t pid, uint32_t tid, cl_event event, const char* pName, const char* pCategory, const std::string& args);
+
+	/* Waits for the recorded commands, takes their times and releases
+	 * their events. Has to be called before the contexts of the devices
+	 * are released, write calls it for the remaining commands.
+	 * */
+	void resolve();
+
+	/* Writes all spans and commands to pFilename, prints the reason and
+	 * returns false on failure
+	 * */
+	bool write(const char* pFilename);
+
+private:
+	struct Span
+	{
+		uint32_t pid;
+		uint32_t tid;
+		std::string name;
+		std::string category;
+		double startUs;
+		double endUs;
+		std::string args;
+		cl_event event; // NULL for host spans
+	};
+
+	struct Calibration
+	{
+		uint32_t pid;
+		cl_event event;
+		double hostUs;
+	};
+
+	bool m_enabled;
+	std::chrono::steady_clock::time_point m_start;
+	std::mutex m_mutex;
+	std::vector<Span> m_spans;
+	std::vector<Calibration> m_calibrations;
+	std::map<uint32_t, double> m_offsets; // Host time of device time 0 per device
+	std::vector<std::string> m_names; // Metadata events
+};
@@ -32,11 +32,18 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <fstream>
 #include <iomanip>
 #include <string>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
 
 #include "hamming.h"
 #include "xcl.h"
 #include "oclErrorCodes.h"
 #include "Timer.h"
+#include "HashFile.h"
+#include "AutoTune.h"
+#include "Trace.h"
 
 #define PERFORMACE
 
@@ -47,7 +54,7 @@ struct hash
 {
 		uint8_t bytes[64];
 
-		hash operator^(const hash& h1)
+		hash operator^(const hash& h1) const
 		{
 			hash res;
 			for (int i = 0; i < 64; i++)
@@ -65,6 +72,32 @@ struct hash
 		}
 };
 
+// Read only view of a contiguous hash array, either a mapped hash file or a vector
+struct HashView
+{
+	const hash* pData;
+	size_t count;
+
+	HashView() : pData(nullptr), count(0) {}
+	HashView(const hash* p, size_t c) : pData(p), count(c) {}
+
+	const hash* data() const { return pData; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	const hash& operator[](size_t i) const { return pData[i]; }
+	const hash& front() const { return pData[0]; }
+	const hash& back() const { return pData[count - 1]; }
+
+	const hash& at(size_t i) const
+	{
+		if (i >= count)
+			throw std::out_of_range("HashView::at");
+
+		return pData[i];
+	}
+};
+
 struct Result
 {
 		uint64_t val;
@@ -86,6 +119,12 @@ struct Result
 			idxA = (uint32_t) (val >> 37) & 0x7FFFFFF;
 		}
 
+		// Same layout as written by the hamming_dist kernels
+		static uint64_t Pack(uint32_t dist, uint64_t idxB, uint64_t idxA)
+		{
+			return (uint64_t) dist | (idxB << 10) | (idxA << 37);
+		}
+
 };
 
 int fromHex(char _i)
@@ -141,6 +180,53 @@ hash stringToHash(std::string const& _s)
 	return ret;
 }
 
+/* Parses a text file with one hex hash per line */
+bool readHexFile(const char* pFilename, std::vector<hash>& data)
+{
+	std::ifstream infile(pFilename);
+
+	if (!infile.is_open())
+	{
+		std::cout << "Error while opening the input file " << pFilename << ". Current Directory: " << system("pwd") << std::endl;
+		return false;
+	}
+
+	std::string s;
+	while (infile >> s)
+		data.push_back(stringToHash(s));
+
+	return true;
+}
+
+static_assert(sizeof(hash) == HASH_FILE_RECORD_SIZE, "Mapped records are used as hash in place");
+
+/* Maps binary hash files in place, hex files are parsed into storage */
+bool loadHashes(const char* pFilename, HashFile& file, std::vector<hash>& storage, HashView& view)
+{
+	if (HashFile::isHashFile(pFilename))
+	{
+		if (!file.open(pFilename))
+			return false;
+
+		view = HashView((const hash*) file.data(), file.size());
+	}
+	else
+	{
+		if (!readHexFile(pFilename, storage))
+			return false;
+
+		view = HashView(storage.data(), storage.size());
+	}
+
+	if (view.empty())
+	{
+		std::cout << "The input file " << pFilename << " does not contain any hashes." << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
 std::string hps(double val)
 {
 	std::string str = "";
@@ -223,279 +309,539 @@ uint32_t popCnt512(hash n)
 	return res;
 }
 
-int gen_random()
+/* Stable sorts the hashes by popcount into sorted, returns the original index of every sorted entry */
+std::vector<uint32_t> sortByPopcount(const HashView& data, std::vector<hash>& sorted)
 {
-	static std::default_random_engine e;
-	static std::uniform_int_distribution<int> dist(0, 100);
+	std::vector<uint32_t> pops(data.size());
+	std::vector<uint32_t> order(data.size());
 
-	return dist(e);
+	for (size_t i = 0; i < data.size(); i++)
+		pops[i] = popCnt512(data[i]);
+
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&pops](uint32_t a, uint32_t b) { return pops[a] < pops[b]; });
+
+	sorted.resize(data.size());
+
+	for (size_t i = 0; i < data.size(); i++)
+		sorted[i] = data[order[i]];
+
+	return order;
 }
 
-int main(int argc, char* argv[])
-{
-	Timer fullTime;
-	fullTime.start();
-	cl_int err;
+// Resume position of a static tile whose results all fit into the output region
+#define NO_RESUME 0xFFFFFFFF
 
-	if (argc < 4)
-	{
-		std::cout << "Usage: " << argv[0] << " <kernel> <global-size> <local-size>" << std::endl;
-		return -1;
-	}
+/* One kernel launch over a static tile of a chunk, starting at pair
+ * resumeFrom of the tile and ending at dynamic hash seqBLength of the chunk
+ * */
+struct TileLaunch
+{
+	uint32_t seqAOffset;
+	uint32_t seqALength;
+	uint32_t seqBLength;
+	uint32_t resumeFrom;
+	uint32_t tileIdx;
+};
 
-	const char *pXclbinFilename = argv[1];
+/* Buffers and events of one chunk in flight, every slot has its own
+ * pinned input buffer, result regions and state which are reused for
+ * every chunk that goes through the slot
+ * */
+struct ChunkSlot
+{
+	cl_mem dynBuffer;
+	cl_mem outputBuffers[2]; // A resumed launch fills one while the other is read back
+	cl_mem stateBuffer; // Result counter followed by the resume position of every static tile
+	cl_event writeEvent;
+	std::vector<cl_event> kernelEvents;
+	cl_event stateEvent;
+	std::vector<uint32_t> state;
+	std::vector<TileLaunch> launches;
+	std::vector<TileLaunch> pending; // Resumed tiles that wait for a stalled one
+	uint32_t seqBOffset;
+	uint32_t seqBLength;
+	int outputIdx;
+	uint32_t index; // Position in the ring
+	size_t chunk; // Sequence number of the chunk in the slot
+};
 
-	xcl_world world;
+/* Kernel configuration shared by all launches */
+struct LaunchConfig
+{
+	cl_command_queue queue;
 	cl_kernel krnl;
+	cl_kernel krnlSpec; // Specialized for full chunks and static tiles, may be NULL
+	uint32_t specSeqBLength;
+	uint32_t specSeqALength;
+	size_t specLaunches;
+	size_t genericLaunches;
+	bool ndrange;
+	size_t global;
+	size_t local;
+	uint32_t capacity;
+	const uint32_t* pStateInit;
+	Trace* pTrace;
+	uint32_t tracePid; // Timeline process of the device
+};
 
-	if (strstr(argv[1], ".xclbin") != NULL)
-	{
-//		world = xcl_world_single(CL_DEVICE_TYPE_ACCELERATOR, tarVendor, pTarDevName);
-		krnl = xcl_import_binary(world, pXclbinFilename, "hamming_dist");
-	}
-	else
-	{
-		world = xcl_world_single(CL_DEVICE_TYPE_CPU, NULL, NULL);
-		krnl = xcl_import_source(world, pXclbinFilename, "hamming_dist");
-	}
+// Timeline tracks of a slot, the input buffer and the two output regions
+#define TRACE_TRACKS_PER_SLOT 3
 
-	// --------- LOAD INPUT DATA ---------
-	Timer execTimer;
-	execTimer.start();
+uint32_t traceTrack(const ChunkSlot& slot, int part)
+{
+	return slot.index * TRACE_TRACKS_PER_SLOT + part;
+}
 
-	std::vector<hash> staticData;
-	std::vector<hash> dynData;
+/* Timeline args of a command of the chunk in the slot */
+std::string traceArgs(const ChunkSlot& slot, const TileLaunch* pLaunch = nullptr)
+{
+	std::string args = "{\"chunk\":" + std::to_string(slot.chunk) + ",\"offset\":" + std::to_string(slot.seqBOffset) + ",\"length\":" + std::to_string(slot.seqBLength) + ",\"region\":" + std::to_string(slot.outputIdx);
 
-	std::ifstream infile("a.txt");
+	if (pLaunch)
+		args += ",\"tile\":" + std::to_string(pLaunch->tileIdx) + ",\"resumeFrom\":" + std::to_string(pLaunch->resumeFrom) + ",\"seqBLength\":" + std::to_string(pLaunch->seqBLength);
 
-	if (!infile.is_open())
+	return args + "}";
+}
+
+/* Names the process of the device and the tracks of its slots */
+void traceSlots(const LaunchConfig& cfg, const std::string& device, size_t depth)
+{
+	cfg.pTrace->nameProcess(cfg.tracePid, device);
+
+	for (uint32_t s = 0; s < depth; s++)
 	{
-		std::cout << "Error while opening the input file. Current Directory: " << system("pwd") << std::endl;
-		return -1;
+		cfg.pTrace->nameThread(cfg.tracePid, s * TRACE_TRACKS_PER_SLOT, "slot " + std::to_string(s) + " input");
+		cfg.pTrace->nameThread(cfg.tracePid, s * TRACE_TRACKS_PER_SLOT + 1, "slot " + std::to_string(s) + " region 0");
+		cfg.pTrace->nameThread(cfg.tracePid, s * TRACE_TRACKS_PER_SLOT + 2, "slot " + std::to_string(s) + " region 1");
 	}
+}
 
-	std::string s;
-	while (infile >> s)
-		staticData.push_back(stringToHash(s));
+cl_ulong eventTime(cl_event event)
+{
+	cl_ulong time_start = 0;
+	cl_ulong time_end = 0;
 
-	infile.close();
-	infile.open("b_1m.txt");
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &time_start, NULL);
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &time_end, NULL);
 
-	if (!infile.is_open())
+	return time_end >= time_start ? time_end - time_start : 0;
+}
+
+/* Enqueues the launches of the slot after the given events, followed by a
+ * non-blocking read of the state
+ * */
+void launchTiles(LaunchConfig& cfg, ChunkSlot& slot, cl_uint numDeps, const cl_event* pDeps)
+{
+	const cl_uint argBase = cfg.ndrange ? 10 : 7;
+
+	// All launches of a chunk share its result region and counter
+	for (const TileLaunch& l : slot.launches)
 	{
-		std::cout << "Error while opening the input file. Current Directory: " << system("pwd") << std::endl;
-		return -1;
+		// Ragged tails and launches cut short run the generic kernel
+		const bool spec = cfg.krnlSpec && l.seqBLength == cfg.specSeqBLength && (!cfg.ndrange || l.seqALength == cfg.specSeqALength);
+		cl_kernel krnl = spec ? cfg.krnlSpec : cfg.krnl;
+		(spec ? cfg.specLaunches : cfg.genericLaunches)++;
+
+		xcl_set_kernel_arg(krnl, 0, sizeof(cl_mem), &slot.outputBuffers[slot.outputIdx]);
+		xcl_set_kernel_arg(krnl, 2, sizeof(cl_mem), &slot.dynBuffer);
+		xcl_set_kernel_arg(krnl, 3, sizeof(uint32_t), &l.seqBLength);
+		xcl_set_kernel_arg(krnl, 4, sizeof(uint32_t), &slot.seqBOffset);
+		xcl_set_kernel_arg(krnl, 6, sizeof(cl_mem), &slot.stateBuffer);
+		xcl_set_kernel_arg(krnl, argBase, sizeof(uint32_t), &cfg.capacity);
+		xcl_set_kernel_arg(krnl, argBase + 1, sizeof(uint32_t), &l.resumeFrom);
+
+		if (cfg.ndrange)
+		{
+			xcl_set_kernel_arg(krnl, 7, sizeof(uint32_t), &l.seqALength);
+			xcl_set_kernel_arg(krnl, 8, sizeof(uint32_t), &l.seqAOffset);
+			xcl_set_kernel_arg(krnl, argBase + 2, sizeof(uint32_t), &l.tileIdx);
+		}
+
+		cl_event kernelEvent;
+		OCL_CHECK(clEnqueueNDRangeKernel(cfg.queue, krnl, 1, nullptr, &cfg.global, &cfg.local, numDeps, pDeps, &kernelEvent));
+		slot.kernelEvents.push_back(kernelEvent);
+
+		if (cfg.pTrace->enabled())
+			cfg.pTrace->command(cfg.tracePid, traceTrack(slot, 1 + slot.outputIdx), kernelEvent, spec ? "kernel (specialized)" : "kernel", "kernel", traceArgs(slot, &l));
 	}
 
-	while (infile >> s)
-		dynData.push_back(stringToHash(s));
+	if (slot.kernelEvents.empty())
+		OCL_CHECK(clEnqueueReadBuffer(cfg.queue, slot.stateBuffer, CL_FALSE, 0, slot.state.size() * sizeof(uint32_t), slot.state.data(), numDeps, pDeps, &slot.stateEvent))
+	else
+		OCL_CHECK(clEnqueueReadBuffer(cfg.queue, slot.stateBuffer, CL_FALSE, 0, slot.state.size() * sizeof(uint32_t), slot.state.data(), (cl_uint) slot.kernelEvents.size(), slot.kernelEvents.data(), &slot.stateEvent))
 
-	printf("---Static Data(%lu)---\nFirst: ", staticData.size());
+	if (cfg.pTrace->enabled())
+		cfg.pTrace->command(cfg.tracePid, traceTrack(slot, 1 + slot.outputIdx), slot.stateEvent, "read state", "transfer", traceArgs(slot));
+}
 
-	for (int j = 0; j < 64; j++)
-		printf("%02x", staticData.front().bytes[j]);
+/* Number of a stored result in the pair order of its kernel, results
+ * before the resume position of their tile are complete
+ * */
+uint32_t pairIndex(const LaunchConfig& cfg, const ChunkSlot& slot, const TileLaunch& l, const Result& r)
+{
+	if (cfg.ndrange)
+		return (r.idxB - slot.seqBOffset) * l.seqALength + (r.idxA - l.seqAOffset);
 
-	printf("\nLast:  ");
+	return r.idxA * l.seqBLength + (r.idxB - slot.seqBOffset);
+}
 
-	for (int j = 0; j < 64; j++)
-		printf("%02x", staticData.back().bytes[j]);
+/* Waits for the chunk of the slot and appends its results. Tiles whose
+ * results did not fit into the output region are resumed from their first
+ * dropped pair into the other region while the stored results are read
+ * back, until the chunk is complete. Returns the number of resumes.
+ * */
+size_t drainSlot(LaunchConfig& cfg, ChunkSlot& slot, std::vector<uint64_t>& results, cl_ulong& kernelExecTime, cl_ulong& writeTime)
+{
+	size_t resumes = 0;
 
-	printf("\n");
+	for (;;)
+	{
+		OCL_CHECK(clWaitForEvents(1, &slot.stateEvent));
 
-	printf("---Dynamic Data(%lu)---\nFirst: ", dynData.size());
+		for (cl_event e : slot.kernelEvents)
+		{
+			kernelExecTime += eventTime(e);
+			OCL_CHECK(clReleaseEvent(e));
+		}
 
-	for (int j = 0; j < 64; j++)
-		printf("%02x", dynData.front().bytes[j]);
+		slot.kernelEvents.clear();
 
-	printf("\nLast:  ");
+		// The NDRange kernel keeps counting after the region is full
+		const uint32_t stored = std::min(slot.state[0], cfg.capacity);
+		std::vector<TileLaunch> next;
+		next.swap(slot.pending);
 
-	for (int j = 0; j < 64; j++)
-		printf("%02x", dynData.back().bytes[j]);
+		for (const TileLaunch& l : slot.launches)
+		{
+			TileLaunch r = l;
 
-	printf("\n");
+			if (slot.state[1 + l.tileIdx] != NO_RESUME)
+				r.resumeFrom = slot.state[1 + l.tileIdx];
+			else if (l.seqBLength < slot.seqBLength)
+			{
+				// Continue after a launch that was cut short
+				r.resumeFrom = l.seqBLength * l.seqALength;
+				r.seqBLength = slot.seqBLength;
+			}
+			else
+				continue;
 
-	execTimer.stop();
-	printf("Input data load time: %0.3f ms\n", execTimer.getElapsedTimeInMilliSec());
+			next.push_back(r);
+		}
 
-	// --------- LOAD INPUT DATA ---------
+		if (next.empty())
+		{
+			if (stored > 0)
+			{
+				const size_t base = results.size();
+				cl_event readEvent = nullptr;
+				results.resize(base + stored);
+				OCL_CHECK(clEnqueueReadBuffer(cfg.queue, slot.outputBuffers[slot.outputIdx], CL_TRUE, 0, stored * sizeof(uint64_t), &results[base], 1, &slot.stateEvent, cfg.pTrace->enabled() ? &readEvent : NULL));
+
+				if (readEvent)
+				{
+					cfg.pTrace->command(cfg.tracePid, traceTrack(slot, 1 + slot.outputIdx), readEvent, "read results", "transfer", traceArgs(slot));
+					OCL_CHECK(clReleaseEvent(readEvent));
+				}
+			}
 
-	// We will break down our problem into multiple iterations. Each iteration
-	// will perform computation on a subset of the entire data-set.
-	size_t elements_per_iteration = SEQ_A_SIZE;
-	size_t num_iterations = (dynData.size() + elements_per_iteration - 1) / elements_per_iteration;
+			OCL_CHECK(clReleaseEvent(slot.stateEvent));
+			break;
+		}
 
-	if (num_iterations < 1)
-		num_iterations = 1;
+		// Read back the stored results while the resumed launches fill the other region
+		const std::vector<uint32_t> resumeAt = slot.state;
+		const std::vector<TileLaunch> done = slot.launches;
+		std::vector<uint64_t> part(stored);
+		cl_event readEvent = nullptr;
+		cl_event resetEvent;
 
-	clReleaseCommandQueue(world.command_queue);
-	world.command_queue = clCreateCommandQueue(world.context, world.device_id, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_PROFILING_ENABLE, &err);
+		if (stored > 0)
+			OCL_CHECK(clEnqueueReadBuffer(cfg.queue, slot.outputBuffers[slot.outputIdx], CL_FALSE, 0, stored * sizeof(uint64_t), part.data(), 1, &slot.stateEvent, &readEvent));
 
-	std::vector<uint64_t> deviceResult(MAX_OUTPUT_DATA_SIZE);
+		OCL_CHECK(clEnqueueWriteBuffer(cfg.queue, slot.stateBuffer, CL_FALSE, 0, slot.state.size() * sizeof(uint32_t), cfg.pStateInit, 1, &slot.stateEvent, &resetEvent));
+		OCL_CHECK(clReleaseEvent(slot.stateEvent));
 
-	// This pair of events will be used to track when a kernel is finished with
-	// the input buffers. Once the kernel is finished processing the data, a new
-	// set of elements will be written into the buffer.
-	std::array<cl_event, 2> kernel_events;
-	std::array<cl_event, 2> read_events;
+		if (cfg.pTrace->enabled())
+		{
+			cfg.pTrace->command(cfg.tracePid, traceTrack(slot, 1 + slot.outputIdx), readEvent, "read results", "transfer", traceArgs(slot));
+			cfg.pTrace->command(cfg.tracePid, traceTrack(slot, 0), resetEvent, "reset state", "transfer", traceArgs(slot));
+		}
 
-	cl_mem staticDataBuffer = clCreateBuffer(world.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, SEQ_A_BYTE_SIZE, staticData.data(), NULL);
+		// A tile stalls when all of its stored hits are behind its first dropped
+		// one, hits of other work items won the output region. It is resumed alone
+		// over as many dynamic hashes as the region can hold all hits of, the
+		// capacity covers at least one of them, see main.
+		auto stalled = std::find_if(next.begin(), next.end(), [&done](const TileLaunch& r)
+		{
+			for (const TileLaunch& l : done)
+			{
+				if (l.tileIdx == r.tileIdx)
+					return l.resumeFrom == r.resumeFrom;
+			}
 
-	cl_mem dynamicDataBuffer[2];
+			return false;
+		});
 
-	uint32_t resCnt = 0;
+		if (cfg.ndrange && stalled != next.end())
+		{
+			TileLaunch r = *stalled;
+			next.erase(stalled);
+			r.seqBLength = std::min(r.seqBLength, r.resumeFrom / r.seqALength + std::max(cfg.capacity / r.seqALength, 1u));
+			slot.launches.assign(1, r);
+			slot.pending = next;
+		}
+		else
+			slot.launches = next;
 
-	cl_mem resCntBuffer = clCreateBuffer(world.context, CL_MEM_READ_WRITE, sizeof(uint32_t), NULL, NULL);
-	clEnqueueWriteBuffer(world.command_queue, resCntBuffer, CL_FALSE, 0, sizeof(uint32_t), &resCnt, 0, NULL, NULL);
+		slot.outputIdx ^= 1;
+		launchTiles(cfg, slot, 1, &resetEvent);
+		OCL_CHECK(clReleaseEvent(resetEvent));
+		resumes++;
 
-	cl_event staticEvent;
-	OCL_CHECK(clEnqueueMigrateMemObjects(world.command_queue, 1, &staticDataBuffer, 0 /* flags, 0 means from host */, 0, NULL, &staticEvent));
+		if (readEvent)
+		{
+			OCL_CHECK(clWaitForEvents(1, &readEvent));
+			OCL_CHECK(clReleaseEvent(readEvent));
+		}
 
-	xcl_set_kernel_arg(krnl, 6, sizeof(cl_mem), &resCntBuffer);
-	xcl_set_kernel_arg(krnl, 1, sizeof(cl_mem), &staticDataBuffer);
-	clWaitForEvents(1, &staticEvent);
+		for (uint64_t v : part)
+		{
+			Result r(v);
 
-	cl_ulong write_time = 0;
-	cl_ulong time_start;
-	cl_ulong time_end;
+			for (const TileLaunch& l : done)
+			{
+				if (r.idxA >= l.seqAOffset && r.idxA < l.seqAOffset + l.seqALength)
+				{
+					if (pairIndex(cfg, slot, l, r) < resumeAt[1 + l.tileIdx])
+						results.push_back(v);
 
-	size_t global = atoi(argv[2]);
-	size_t local = atoi(argv[3]);
+					break;
+				}
+			}
+		}
+	}
 
-	cl_ulong kernelExecTime = 0;
+	writeTime += eventTime(slot.writeEvent);
+	OCL_CHECK(clReleaseEvent(slot.writeEvent));
 
-	uint32_t threshold = 200;
+	slot.stateEvent = nullptr;
+	slot.writeEvent = nullptr;
 
-	xcl_set_kernel_arg(krnl, 5, sizeof(uint32_t), &threshold);
+	return resumes;
+}
 
-	cl_mem outputBuffer = clCreateBuffer(world.context, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR, MAX_OUTPUT_DATA_SIZE * sizeof(uint64_t), &deviceResult[0], NULL);
-	xcl_set_kernel_arg(krnl, 0, sizeof(cl_mem), &outputBuffer);
+/* Build options of a program specialized for full chunks and static
+ * tiles, see hamming_dist.cl
+ * */
+std::string specializationOptions(bool ndrange, uint32_t threshold, size_t seqBLength, size_t seqALength, uint32_t capacity)
+{
+	char options[256];
 
-	std::cout << "Iterations: " << num_iterations << std::endl;
+	if (ndrange)
+		snprintf(options, sizeof(options), "-DSPEC_THRESHOLD=%uu -DSPEC_SEQ_B_LENGTH=%uu -DSPEC_SEQ_A_LENGTH=%uu -DSPEC_RES_CAPACITY=%uu", threshold, (uint32_t) seqBLength, (uint32_t) seqALength, capacity);
+	else
+		snprintf(options, sizeof(options), "-DSPEC_THRESHOLD=%uu -DSPEC_SEQ_B_LENGTH=%uu -DSPEC_RES_CAPACITY=%uu", threshold, (uint32_t) seqBLength, capacity);
 
-	execTimer.start();
+	return options;
+}
 
-	for (size_t iteration_idx = 0; iteration_idx < num_iterations; iteration_idx++)
-	{
-		int flag = iteration_idx % 2;
-		uint32_t seqBOffset = elements_per_iteration * iteration_idx;
+/* Static hashes per local memory tile of hamming_dist_ndrange on the
+ * device, at most requested if that is not 0. Returns 0 if not even a
+ * single hash fits.
+ * */
+size_t staticTileSizeFor(cl_device_id device, size_t requested, cl_ulong& localMemSize)
+{
+	localMemSize = 0;
+	clGetDeviceInfo(device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &localMemSize, NULL);
 
-		uint32_t seqBPartLength = (dynData.size() - seqBOffset < (uint32_t) SEQ_A_SIZE) ? dynData.size() - seqBOffset : SEQ_A_SIZE;
+	// Leave room for the hit buffer and the counters of the kernel
+	const size_t reserved = LOCAL_HITS_SIZE * sizeof(uint64_t) + 64;
+	const size_t maxTile = localMemSize > reserved ? (size_t) (localMemSize - reserved) / sizeof(hash) : 0;
 
-		if (iteration_idx >= 2)
-		{
-			clWaitForEvents(1, &read_events[flag]);
+	return std::min(requested ? requested : maxTile, maxTile);
+}
 
-			if (kernel_events[flag])
-			{
-				clWaitForEvents(1, &kernel_events[flag]);
-				clGetEventProfilingInfo(kernel_events[flag], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &time_start, NULL);
-				clGetEventProfilingInfo(kernel_events[flag], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &time_end, NULL);
-				if (time_end >= time_start)
-					kernelExecTime += time_end - time_start;
-			}
+/* Results per output region of a device with depth slots. Every slot
+ * double buffers its output region, all regions together take at most a
+ * quarter of the device memory. More results than pairs of a chunk can
+ * not occur.
+ * */
+size_t resultCapacityFor(cl_device_id device, size_t depth, size_t chunk, size_t staticCompared, size_t tileSize)
+{
+	cl_ulong globalMemSize = 0;
+	cl_ulong maxAllocSize = 0;
+	clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &globalMemSize, NULL);
+	clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &maxAllocSize, NULL);
 
-			OCL_CHECK(clReleaseMemObject(dynamicDataBuffer[flag]));
-			OCL_CHECK(clReleaseEvent(read_events[flag]));
-			OCL_CHECK(clReleaseEvent(kernel_events[flag]));
-			dynamicDataBuffer[flag] = nullptr;
-			read_events[flag] = nullptr;
-			kernel_events[flag] = nullptr;
-		}
+	size_t capacity = (size_t) std::min<cl_ulong>(globalMemSize / 4 / (2 * depth), maxAllocSize) / sizeof(uint64_t);
+	capacity = std::min(capacity, std::min((size_t) MAX_OUTPUT_DATA_SIZE, chunk * staticCompared));
 
-		if (resCnt >= (uint32_t) MAX_OUTPUT_DATA_SIZE)
-		{
-			std::cout << "Result overflow, to many possible results to fit into memory, please adjust the threshold." << std::endl;
-			break;
-		}
+	return std::max(capacity, tileSize);
+}
 
-		dynamicDataBuffer[flag] = clCreateBuffer(world.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, SEQ_A_BYTE_SIZE, &dynData[seqBOffset], NULL);
+/* Work sizes of the kernel on the device of world. The sweep runs once
+ * per device and kernel source, later runs load its result from the tune
+ * file next to the kernel.
+ * */
+WorkSizes workSizesFor(xcl_world world, cl_kernel krnl, const char* pKernelFile, bool ndrange, const HashView& staticData, size_t staticCount, const HashView& dynData, bool retune)
+{
+	const std::string tuneFile = std::string(pKernelFile) + ".tune";
+	const char* pKernelName = ndrange ? "hamming_dist_ndrange" : "hamming_dist";
+	const unsigned long long key = xcl_source_key(world, pKernelFile);
+	WorkSizes sizes;
 
-		cl_event write_event;
+	if (!retune && loadWorkSizes(tuneFile.c_str(), key, pKernelName, sizes))
+	{
+		std::cout << "Loaded tuned work sizes from " << tuneFile << std::endl;
+		return sizes;
+	}
 
-		OCL_CHECK(clEnqueueMigrateMemObjects(world.command_queue, 1, &dynamicDataBuffer[flag], 0 /* flags, 0 means from host */, 0, NULL, &write_event));
+	TuneContext ctx;
+	ctx.world = world;
+	ctx.krnl = krnl;
+	ctx.ndrange = ndrange;
+	ctx.pStatic = staticData.data();
+	ctx.staticCount = staticCount;
+	ctx.pDyn = dynData.data();
+	ctx.dynCount = dynData.size();
 
-		xcl_set_kernel_arg(krnl, 2, sizeof(cl_mem), &dynamicDataBuffer[flag]);
-		xcl_set_kernel_arg(krnl, 3, sizeof(uint32_t), &seqBPartLength);
-		xcl_set_kernel_arg(krnl, 4, sizeof(uint32_t), &seqBOffset);
+	Timer tuneTimer;
+	tuneTimer.start();
+	sizes = tuneWorkSizes(ctx);
+	tuneTimer.stop();
+	printf("Tuning time: %0.3f ms\n", tuneTimer.getElapsedTimeInMilliSec());
 
-		OCL_CHECK(clEnqueueNDRangeKernel(world.command_queue, krnl, 1, nullptr, &global, &local, 1, &write_event, &kernel_events[flag]));
+	storeWorkSizes(tuneFile.c_str(), key, pKernelName, sizes);
 
-		clEnqueueReadBuffer(world.command_queue, resCntBuffer, CL_FALSE, 0, sizeof(uint32_t), &resCnt, 1, &kernel_events[flag], &read_events[flag]);
+	return sizes;
+}
 
-		clGetEventProfilingInfo(write_event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &time_start, NULL);
-		clGetEventProfilingInfo(write_event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &time_end, NULL);
-		if (time_end >= time_start)
-			write_time += time_end - time_start;
+/* Sets the arguments that are the same for every launch */
+void setStaticArgs(const LaunchConfig& cfg, cl_mem staticBuffer, uint32_t threshold, size_t tileSize)
+{
+	for (cl_kernel k : { cfg.krnl, cfg.krnlSpec })
+	{
+		if (k == NULL)
+			continue;
 
-		OCL_CHECK(clReleaseEvent(write_event));
-	}
+		xcl_set_kernel_arg(k, 1, sizeof(cl_mem), &staticBuffer);
+		xcl_set_kernel_arg(k, 5, sizeof(uint32_t), &threshold);
 
-	// Wait for all of the OpenCL operations to complete
-	printf("Waiting...\n");
-	clFlush(world.command_queue);
-	clFinish(world.command_queue);
-	std::cout << "Final Count: " << resCnt << std::endl;
+		if (cfg.ndrange)
+			xcl_set_kernel_arg(k, 9, tileSize * sizeof(hash), NULL);
+	}
+}
 
-	if (resCnt > 0)
+/* Ring of pinned input buffers, the chunks are streamed through them with clEnqueueWriteBuffer */
+void createSlots(cl_context context, std::vector<ChunkSlot>& slots, size_t chunk, size_t capacity, size_t stateSize)
+{
+	for (size_t i = 0; i < slots.size(); i++)
 	{
-		if (read_events[0])
-			OCL_CHECK(clReleaseEvent(read_events[0]));
+		ChunkSlot& slot = slots[i];
+		slot.index = (uint32_t) i;
+		slot.dynBuffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, chunk * sizeof(hash), NULL, NULL);
+		slot.outputBuffers[0] = clCreateBuffer(context, CL_MEM_WRITE_ONLY, capacity * sizeof(uint64_t), NULL, NULL);
+		slot.outputBuffers[1] = clCreateBuffer(context, CL_MEM_WRITE_ONLY, capacity * sizeof(uint64_t), NULL, NULL);
+		slot.stateBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, stateSize * sizeof(uint32_t), NULL, NULL);
+		slot.state.resize(stateSize);
+	}
+}
 
-		OCL_CHECK(clEnqueueMigrateMemObjects(world.command_queue, 1, &outputBuffer, CL_MIGRATE_MEM_OBJECT_HOST, 0, NULL, &read_events[0]));
-		clEnqueueMapBuffer(world.command_queue, outputBuffer, CL_TRUE, CL_MAP_READ, 0, resCnt * sizeof(uint64_t), 1, &read_events[0], NULL, 0);
+void releaseSlots(std::vector<ChunkSlot>& slots)
+{
+	for (ChunkSlot& slot : slots)
+	{
+		OCL_CHECK(clReleaseMemObject(slot.dynBuffer));
+		OCL_CHECK(clReleaseMemObject(slot.outputBuffers[0]));
+		OCL_CHECK(clReleaseMemObject(slot.outputBuffers[1]));
+		OCL_CHECK(clReleaseMemObject(slot.stateBuffer));
 	}
+}
 
-	execTimer.stop();
+/* Plans one launch per static tile for the chunk of the slot. With sorted
+ * data a tile is skipped when |pop(a) - pop(b)| >= threshold holds for all
+ * of its pairs with the chunk. Returns the number of skipped tiles.
+ * */
+size_t planTiles(ChunkSlot& slot, const HashView& staticData, size_t staticCompared, size_t tileSize, const HashView& dynData, bool popcountSort, uint32_t threshold)
+{
+	const size_t numTiles = (staticCompared + tileSize - 1) / tileSize;
+	const uint32_t dynPopMin = popcountSort ? popCnt512(dynData[slot.seqBOffset]) : 0;
+	const uint32_t dynPopMax = popcountSort ? popCnt512(dynData[slot.seqBOffset + slot.seqBLength - 1]) : 512;
+	size_t skipped = 0;
 
-	// Releasing mem objects and events - make sure to only release 1
-	// element in case length(seq A) == length(seq B)
-	for (int i = 0; i < (num_iterations < 2 ? 1 : 2); i++)
-	{
-		if (read_events[i])
-			OCL_CHECK(clReleaseEvent(read_events[i]));
+	slot.launches.clear();
 
-		if (kernel_events[i])
+	for (size_t t = 0; t < numTiles; t++)
+	{
+		TileLaunch l;
+		l.seqAOffset = (uint32_t) (t * tileSize);
+		l.seqALength = (uint32_t) std::min(staticCompared - l.seqAOffset, tileSize);
+		l.seqBLength = slot.seqBLength;
+		l.resumeFrom = 0;
+		l.tileIdx = (uint32_t) t;
+
+		if (popcountSort && (dynPopMin >= popCnt512(staticData[l.seqAOffset + l.seqALength - 1]) + threshold || popCnt512(staticData[l.seqAOffset]) >= dynPopMax + threshold))
 		{
-			clGetEventProfilingInfo(kernel_events[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &time_start, NULL);
-			clGetEventProfilingInfo(kernel_events[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &time_end, NULL);
-			if (time_end >= time_start)
-				kernelExecTime += time_end - time_start;
-			OCL_CHECK(clReleaseEvent(kernel_events[i]));
+			skipped++;
+			continue;
 		}
 
-		if (dynamicDataBuffer[i])
-			OCL_CHECK(clReleaseMemObject(dynamicDataBuffer[i]));
+		slot.launches.push_back(l);
 	}
 
-	OCL_CHECK(clReleaseMemObject(outputBuffer));
-	OCL_CHECK(clReleaseMemObject(staticDataBuffer));
-	OCL_CHECK(clReleaseMemObject(resCntBuffer));
+	return skipped;
+}
 
-	OCL_CHECK(clReleaseKernel(krnl));
-	xcl_release_world(world);
+/* Resets the state of the slot, copies the dynamic hashes of its chunk
+ * and launches its tiles
+ * */
+void enqueueChunk(LaunchConfig& cfg, ChunkSlot& slot, const hash* pDyn)
+{
+	cl_event deps[2];
 
+	// Only copy the hashes of this chunk, a mapped input file ends right after the last one
+	OCL_CHECK(clEnqueueWriteBuffer(cfg.queue, slot.stateBuffer, CL_FALSE, 0, slot.state.size() * sizeof(uint32_t), cfg.pStateInit, 0, NULL, &deps[0]));
+	OCL_CHECK(clEnqueueWriteBuffer(cfg.queue, slot.dynBuffer, CL_FALSE, 0, slot.seqBLength * sizeof(hash), pDyn, 0, NULL, &deps[1]));
 
-#ifdef PERFORMACE
-	printf("Entire OpenCL execution time: %0.3f ms\n", execTimer.getElapsedTimeInMilliSec());
+	if (cfg.pTrace->enabled())
+	{
+		cfg.pTrace->command(cfg.tracePid, traceTrack(slot, 0), deps[0], "reset state", "transfer", traceArgs(slot));
+		cfg.pTrace->command(cfg.tracePid, traceTrack(slot, 0), deps[1], "write chunk", "transfer", traceArgs(slot));
+	}
 
-	cl_double kernelExecTimeMS = (cl_double)(kernelExecTime)*(cl_double)(1e-06);
+	launchTiles(cfg, slot, 2, deps);
 
-	printf("Execution time for %d elements in milliseconds = %0.3f ms\n", SEQ_A_SIZE * dynData.size(), kernelExecTimeMS);
-	printf("Hashes per second: %s\n", hps((SEQ_A_SIZE * dynData.size()) / (kernelExecTimeMS / 1000.0)).c_str());
+	slot.writeEvent = deps[1];
+	OCL_CHECK(clReleaseEvent(deps[0]));
+}
 
-	printf("Write time in milliseconds = %0.3f ms\n", (cl_double)(write_time)*(cl_double)(1e-06));
+/* Maps the indices of the sorted sets back to the input order */
+void restoreInputOrder(std::vector<uint64_t>& results, const std::vector<uint32_t>& staticOrder, const std::vector<uint32_t>& dynOrder)
+{
+	for (uint64_t& v : results)
+	{
+		Result r(v);
 
-#endif
+		if (r.idxA < staticOrder.size() && r.idxB < dynOrder.size())
+			v = Result::Pack(r.dist, dynOrder[r.idxB], staticOrder[r.idxA]);
+	}
+}
 
-	execTimer.start();
+/* Recomputes the distance of every result on the host */
+void verifyResults(const std::vector<uint64_t>& results, const HashView& staticData, const HashView& dynData)
+{
+	Timer compareTimer;
+	compareTimer.start();
 
 	int missCnt = 0;
 	int matchCnt = 0;
 	int skipCnt = 0;
 
-	for (uint32_t i = 0; i < resCnt; i++)
+	for (size_t i = 0; i < results.size(); i++)
 	{
-		Result r(deviceResult.at(i));
+		Result r(results.at(i));
 
 		if (r.idxA >= staticData.size() || r.idxB >= dynData.size())
 		{
@@ -521,11 +867,1090 @@ int main(int argc, char* argv[])
 			matchCnt++;
 	}
 
-	execTimer.stop();
+	compareTimer.stop();
 
 	std::cout << std::endl << "Skips: " << std::dec << skipCnt << std::endl << "Misses: " << missCnt << std::endl << "Matches: " << matchCnt << std::endl;
 
-	printf("CPU compare time: %0.3f ms\n", execTimer.getElapsedTimeInMilliSec());
+	printf("CPU compare time: %0.3f ms\n", compareTimer.getElapsedTimeInMilliSec());
+}
+
+bool writeTrace(Trace& trace, const char* pTraceFile)
+{
+	if (!trace.write(pTraceFile))
+		return false;
+
+	std::cout << "Trace written to " << pTraceFile << ", open it in chrome://tracing or ui.perfetto.dev" << std::endl;
+
+	return true;
+}
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define POPCNT64(x) __popcnt64(x)
+#else
+#define POPCNT64(x) __builtin_popcountll(x)
+#endif
+
+/* Results of a range of the dynamic set */
+struct RangeResults
+{
+	size_t offset;
+	std::vector<uint64_t> results;
+};
+
+/* Work done by one engine of a co-scheduled run */
+struct EngineLoad
+{
+	std::string name;
+	size_t ranges;
+	size_t hashes;
+	std::vector<RangeResults> results;
+};
+
+/* Hands out consecutive ranges of the dynamic set to the engines of a
+ * co-scheduled run. An engine takes its largest range until the rest gets
+ * short, then its share of the rest by its observed rate, so all engines
+ * finish at about the same time.
+ * */
+class ChunkScheduler
+{
+	public:
+		ChunkScheduler(size_t total, size_t engines) :
+				m_next(0), m_total(total), m_rates(engines, 0.0)
+		{
+		}
+
+		/* Reserves the next range for the engine, returns false when the set is done */
+		bool next(size_t engine, size_t minLength, size_t maxLength, size_t& offset, size_t& length)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			const size_t rest = m_total - m_next;
+
+			if (rest == 0)
+				return false;
+
+			length = maxLength;
+
+			// Engines without a measured rate yet do not count
+			if (m_rates[engine] > 0.0)
+			{
+				const double totalRate = std::accumulate(m_rates.begin(), m_rates.end(), 0.0);
+				length = std::min(length, std::max(minLength, (size_t) (rest * m_rates[engine] / totalRate)));
+			}
+
+			length = std::min(length, rest);
+			offset = m_next;
+			m_next += length;
+
+			return true;
+		}
+
+		/* Records that the engine completed a range of length dynamic hashes
+		 * in seconds, the rate is a moving average over its ranges
+		 * */
+		void done(size_t engine, size_t length, double seconds)
+		{
+			if (seconds <= 0.0)
+				return;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			const double rate = length / seconds;
+			double& r = m_rates[engine];
+			r = r > 0.0 ? 0.75 * r + 0.25 * rate : rate;
+		}
+
+	private:
+		std::mutex m_mutex;
+		size_t m_next;
+		size_t m_total;
+		std::vector<double> m_rates; // Dynamic hashes per second, 0 until the first range is done
+};
+
+/* Input and settings shared by the engines of a co-scheduled run */
+struct CoScheduleRun
+{
+	const char* pKernelFile;
+	HashView staticData;
+	HashView dynData;
+	size_t staticCompared;
+	uint32_t threshold;
+	bool ndrange;
+	bool popcountSort;
+	bool genericOnly;
+	bool autoTune;
+	bool retune;
+	size_t global;
+	size_t local;
+	size_t chunkSize; // 0 = from the work sizes of every device
+	size_t pipelineDepth;
+	bool depthSet;
+	size_t staticTile;
+	size_t resultCapacity;
+	size_t hostThreads;
+	size_t hostChunk;
+	Trace* pTrace;
+};
+
+/* An OpenCL device of a co-scheduled run with its own kernels, static
+ * data and slot ring
+ * */
+struct DeviceEngine
+{
+	xcl_world world;
+	cl_mem staticBuffer;
+	std::vector<ChunkSlot> slots;
+	std::vector<uint32_t> stateInit;
+	LaunchConfig cfg;
+	size_t chunk;
+	size_t tileSize;
+	size_t resumes;
+	cl_ulong kernelTime;
+	cl_ulong writeTime;
+	EngineLoad load;
+};
+
+/* Builds the kernels of the device and sizes its tiles, chunks and
+ * output regions like a single device run, see main. Returns false if
+ * the device can not take part.
+ * */
+bool setupDevice(const CoScheduleRun& run, DeviceEngine& e, uint32_t tracePid)
+{
+	cl_int err;
+	char name[256] = "";
+	clGetDeviceInfo(e.world.device_id, CL_DEVICE_NAME, sizeof(name), name, NULL);
+
+	e.load.name = name;
+	e.load.ranges = 0;
+	e.load.hashes = 0;
+	e.resumes = 0;
+	e.kernelTime = 0;
+	e.writeTime = 0;
+
+	const char* pKernelName = run.ndrange ? "hamming_dist_ndrange" : "hamming_dist";
+	cl_kernel krnl = xcl_import_source(e.world, run.pKernelFile, pKernelName);
+
+	e.tileSize = SEQ_A_SIZE;
+
+	if (run.ndrange)
+	{
+		cl_ulong localMemSize;
+		e.tileSize = staticTileSizeFor(e.world.device_id, run.staticTile, localMemSize);
+
+		if (e.tileSize == 0)
+		{
+			std::cout << "Not enough local memory for a static tile on " << name << ": " << localMemSize << " bytes." << std::endl;
+			xcl_release_kernel(krnl);
+			return false;
+		}
+	}
+
+	size_t global = run.global;
+	size_t local = run.local;
+	size_t depth = run.pipelineDepth;
+	e.chunk = run.chunkSize;
+
+	if (run.autoTune)
+	{
+		WorkSizes sizes = workSizesFor(e.world, krnl, run.pKernelFile, run.ndrange, run.staticData, std::min(e.tileSize, run.staticCompared), run.dynData, run.retune);
+		global = sizes.global;
+		local = sizes.local;
+
+		if (e.chunk == 0)
+			e.chunk = sizes.chunk;
+
+		if (!run.depthSet)
+			depth = sizes.depth;
+	}
+
+	if (e.chunk == 0)
+		e.chunk = run.ndrange ? std::max(global, (size_t) SEQ_A_SIZE) : SEQ_A_SIZE;
+
+	const size_t capacity = run.resultCapacity ? run.resultCapacity : resultCapacityFor(e.world.device_id, depth, e.chunk, run.staticCompared, e.tileSize);
+
+	if ((uint64_t) e.chunk * e.tileSize >= NO_RESUME || capacity < (run.ndrange ? e.tileSize : 1))
+	{
+		std::cout << "Chunk " << e.chunk << ", static tile " << e.tileSize << " and result capacity " << capacity << " do not fit on " << name << "." << std::endl;
+		xcl_release_kernel(krnl);
+		return false;
+	}
+
+	clReleaseCommandQueue(e.world.command_queue);
+	e.world.command_queue = clCreateCommandQueue(e.world.context, e.world.device_id, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_PROFILING_ENABLE, &err);
+
+	e.stateInit.assign(1 + (run.staticCompared + e.tileSize - 1) / e.tileSize, NO_RESUME);
+	e.stateInit[0] = 0;
+
+	e.staticBuffer = clCreateBuffer(e.world.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, run.staticCompared * sizeof(hash), (void*) run.staticData.data(), NULL);
+
+	const double enqueueUs = run.pTrace->now();
+	cl_event staticEvent;
+	OCL_CHECK(clEnqueueMigrateMemObjects(e.world.command_queue, 1, &e.staticBuffer, 0 /* flags, 0 means from host */, 0, NULL, &staticEvent));
+
+	run.pTrace->calibrate(tracePid, staticEvent, enqueueUs);
+	run.pTrace->command(tracePid, 0, staticEvent, "migrate static", "transfer", "");
+
+	e.cfg.queue = e.world.command_queue;
+	e.cfg.krnl = krnl;
+	e.cfg.krnlSpec = NULL;
+	e.cfg.specSeqBLength = (uint32_t) std::min(e.chunk, run.dynData.size());
+	e.cfg.specSeqALength = (uint32_t) std::min(e.tileSize, run.staticCompared);
+	e.cfg.specLaunches = 0;
+	e.cfg.genericLaunches = 0;
+	e.cfg.ndrange = run.ndrange;
+	e.cfg.global = global;
+	e.cfg.local = local;
+	e.cfg.capacity = (uint32_t) capacity;
+	e.cfg.pStateInit = e.stateInit.data();
+	e.cfg.pTrace = run.pTrace;
+	e.cfg.tracePid = tracePid;
+
+	if (!run.genericOnly)
+	{
+		const std::string options = specializationOptions(run.ndrange, run.threshold, e.cfg.specSeqBLength, e.cfg.specSeqALength, e.cfg.capacity);
+		e.cfg.krnlSpec = xcl_import_source(e.world, run.pKernelFile, pKernelName, options.c_str());
+	}
+
+	setStaticArgs(e.cfg, e.staticBuffer, run.threshold, e.tileSize);
+
+	e.slots.resize(depth);
+	createSlots(e.world.context, e.slots, e.chunk, capacity, e.stateInit.size());
+	traceSlots(e.cfg, name, depth);
+
+	clWaitForEvents(1, &staticEvent);
+	OCL_CHECK(clReleaseEvent(staticEvent));
+
+	std::cout << "Device " << name << ": global " << global << " local " << local << " chunk " << e.chunk << " depth " << depth << " static tile " << e.tileSize << " results " << capacity << std::endl;
+
+	return true;
+}
+
+void releaseDevice(DeviceEngine& e)
+{
+	releaseSlots(e.slots);
+	OCL_CHECK(clReleaseMemObject(e.staticBuffer));
+
+	xcl_release_kernel(e.cfg.krnl);
+
+	if (e.cfg.krnlSpec)
+		xcl_release_kernel(e.cfg.krnlSpec);
+
+	xcl_release_world(e.world);
+}
+
+/* Streams the ranges the scheduler hands out through the slot ring of the
+ * device. The rate of the device is measured between the completions of
+ * its ranges, which overlap with up to depth ranges in flight.
+ * */
+void runDevice(const CoScheduleRun& run, ChunkScheduler& scheduler, size_t engine, DeviceEngine& e)
+{
+	const size_t depth = e.slots.size();
+	std::vector<size_t> slotRange(depth);
+	Timer timer;
+	double last = 0.0;
+
+	timer.start();
+
+	auto drain = [&](size_t i)
+	{
+		ChunkSlot& slot = e.slots[i % depth];
+		e.resumes += drainSlot(e.cfg, slot, e.load.results[slotRange[i % depth]].results, e.kernelTime, e.writeTime);
+
+		const double now = timer.getElapsedTimeInSec();
+		scheduler.done(engine, slot.seqBLength, now - last);
+		last = now;
+	};
+
+	size_t issued = 0;
+	size_t offset;
+	size_t length;
+
+	for (;;)
+	{
+		ChunkSlot& slot = e.slots[issued % depth];
+
+		// Reuse the slot of the range depth ranges ago
+		if (issued >= depth)
+			drain(issued - depth);
+
+		// Ranges below a quarter chunk are not worth a launch
+		if (!scheduler.next(engine, std::max<size_t>(e.chunk / 4, 1), e.chunk, offset, length))
+			break;
+
+		slotRange[issued % depth] = e.load.results.size();
+		e.load.results.push_back(RangeResults { offset, { } });
+
+		slot.seqBOffset = (uint32_t) offset;
+		slot.seqBLength = (uint32_t) length;
+		slot.outputIdx = 0;
+		slot.chunk = issued;
+
+		planTiles(slot, run.staticData, run.staticCompared, e.tileSize, run.dynData, run.popcountSort, run.threshold);
+		enqueueChunk(e.cfg, slot, &run.dynData[offset]);
+
+		e.load.ranges++;
+		e.load.hashes += length;
+		issued++;
+	}
+
+	clFlush(e.world.command_queue);
+
+	for (size_t i = issued >= depth ? issued - depth + 1 : 0; i < issued; i++)
+		drain(i);
+
+	clFinish(e.world.command_queue);
+}
+
+/* Compares a range of the dynamic set with the static set on the host,
+ * in the same order as the merged results
+ * */
+void compareOnHost(const CoScheduleRun& run, size_t offset, size_t length, std::vector<uint64_t>& results)
+{
+	uint64_t a[8];
+	uint64_t b[8];
+
+	for (size_t j = offset; j < offset + length; j++)
+	{
+		memcpy(b, run.dynData[j].bytes, sizeof(b));
+
+		for (size_t i = 0; i < run.staticCompared; i++)
+		{
+			memcpy(a, run.staticData[i].bytes, sizeof(a));
+
+			uint32_t dist = 0;
+
+			for (int w = 0; w < 8; w++)
+				dist += (uint32_t) POPCNT64(a[w] ^ b[w]);
+
+			if (dist < run.threshold)
+				results.push_back(Result::Pack(dist, j, i));
+		}
+	}
+}
+
+/* Worker thread of the host that takes ranges like a device, its ranges
+ * are on track tid of the host in the timeline
+ * */
+void runHost(const CoScheduleRun& run, ChunkScheduler& scheduler, size_t engine, uint32_t tid, EngineLoad& load)
+{
+	Timer timer;
+	size_t offset;
+	size_t length;
+
+	while (scheduler.next(engine, std::max<size_t>(run.hostChunk / 4, 1), run.hostChunk, offset, length))
+	{
+		const double startUs = run.pTrace->now();
+		timer.start();
+
+		load.results.push_back(RangeResults { offset, { } });
+		compareOnHost(run, offset, length, load.results.back().results);
+
+		timer.stop();
+		scheduler.done(engine, length, timer.getElapsedTimeInSec());
+		run.pTrace->hostSpan(0, tid, "compare range", startUs, run.pTrace->now(), "{\"offset\":" + std::to_string(offset) + ",\"length\":" + std::to_string(length) + "}");
+
+		load.ranges++;
+		load.hashes += length;
+	}
+}
+
+/* Order of the merged results, by dynamic and then static index */
+bool resultBefore(uint64_t a, uint64_t b)
+{
+	const Result ra(a);
+	const Result rb(b);
+
+	return ra.idxB != rb.idxB ? ra.idxB < rb.idxB : ra.idxA < rb.idxA;
+}
+
+/* Splits the dynamic set between the OpenCL devices of worlds and
+ * run.hostThreads worker threads of the host, every engine streams the
+ * ranges it gets from a shared scheduler. The results of all engines are
+ * merged ordered by dynamic and then static index. Releases the worlds.
+ * */
+bool coSchedule(const CoScheduleRun& run, const std::vector<xcl_world>& worlds, std::vector<uint64_t>& results)
+{
+	std::vector<DeviceEngine> devices(worlds.size());
+	size_t numDevices = 0;
+
+	for (const xcl_world& world : worlds)
+	{
+		devices[numDevices].world = world;
+
+		// Process 0 of the timeline is the host
+		if (setupDevice(run, devices[numDevices], (uint32_t) numDevices + 1))
+			numDevices++;
+		else
+			xcl_release_world(world);
+	}
+
+	devices.resize(numDevices);
+
+	if (numDevices + run.hostThreads == 0)
+	{
+		std::cout << "No device or host thread to compare on." << std::endl;
+		return false;
+	}
+
+	std::vector<EngineLoad> hosts(run.hostThreads);
+
+	for (size_t t = 0; t < hosts.size(); t++)
+	{
+		hosts[t].name = "host thread " + std::to_string(t);
+		hosts[t].ranges = 0;
+		hosts[t].hashes = 0;
+		run.pTrace->nameThread(0, (uint32_t) t + 1, hosts[t].name);
+	}
+
+	std::cout << "Co-scheduling on " << numDevices << " devices and " << run.hostThreads << " host threads" << std::endl;
+
+	ChunkScheduler scheduler(run.dynData.size(), numDevices + hosts.size());
+	std::vector<std::thread> threads;
+	Timer runTimer;
+	const double startUs = run.pTrace->now();
+
+	runTimer.start();
+
+	for (size_t d = 0; d < numDevices; d++)
+		threads.emplace_back(runDevice, std::cref(run), std::ref(scheduler), d, std::ref(devices[d]));
+
+	for (size_t t = 0; t < hosts.size(); t++)
+		threads.emplace_back(runHost, std::cref(run), std::ref(scheduler), numDevices + t, (uint32_t) t + 1, std::ref(hosts[t]));
+
+	for (std::thread& t : threads)
+		t.join();
+
+	runTimer.stop();
+	run.pTrace->hostSpan(0, 0, "co-schedule", startUs, run.pTrace->now());
+	run.pTrace->resolve();
+
+	// The ranges are disjoint, ordering them and every range on its own orders all results
+	std::vector<EngineLoad*> loads;
+	std::vector<RangeResults*> ranges;
+
+	for (DeviceEngine& e : devices)
+		loads.push_back(&e.load);
+
+	for (EngineLoad& h : hosts)
+		loads.push_back(&h);
+
+	for (EngineLoad* pLoad : loads)
+	{
+		for (RangeResults& r : pLoad->results)
+			ranges.push_back(&r);
+	}
+
+	std::sort(ranges.begin(), ranges.end(), [](const RangeResults* pA, const RangeResults* pB) { return pA->offset < pB->offset; });
+
+	for (RangeResults* pRange : ranges)
+	{
+		std::sort(pRange->results.begin(), pRange->results.end(), resultBefore);
+		results.insert(results.end(), pRange->results.begin(), pRange->results.end());
+	}
+
+	for (const EngineLoad* pLoad : loads)
+		printf("%s: %llu ranges, %llu hashes (%0.1f %%)\n", pLoad->name.c_str(), (unsigned long long) pLoad->ranges, (unsigned long long) pLoad->hashes, 100.0 * pLoad->hashes / run.dynData.size());
+
+	cl_ulong kernelExecTime = 0;
+	cl_ulong writeTime = 0;
+	size_t resumes = 0;
+
+	for (DeviceEngine& e : devices)
+	{
+		kernelExecTime += e.kernelTime;
+		writeTime += e.writeTime;
+		resumes += e.resumes;
+		releaseDevice(e);
+	}
+
+	if (resumes > 0)
+		std::cout << "Result overflow resumed " << resumes << " times." << std::endl;
+
+	std::cout << "Final Count: " << results.size() << std::endl;
+
+#ifdef PERFORMACE
+	const double runTimeMS = runTimer.getElapsedTimeInMilliSec();
+
+	printf("Co-scheduled execution time for %llu elements in milliseconds = %0.3f ms\n", (unsigned long long) (run.staticCompared * run.dynData.size()), runTimeMS);
+	printf("Hashes per second: %s\n", hps((run.staticCompared * run.dynData.size()) / (runTimeMS / 1000.0)).c_str());
+	printf("Device kernel time in milliseconds = %0.3f ms\n", (cl_double)(kernelExecTime)*(cl_double)(1e-06));
+	printf("Write time in milliseconds = %0.3f ms\n", (cl_double)(writeTime)*(cl_double)(1e-06));
+#endif
+
+	return true;
+}
+
+int gen_random()
+{
+	static std::default_random_engine e;
+	static std::uniform_int_distribution<int> dist(0, 100);
+
+	return dist(e);
+}
+
+int main(int argc, char* argv[])
+{
+	Timer fullTime;
+	fullTime.start();
+	cl_int err;
+
+	if (argc < 4)
+	{
+		std::cout << "Usage: " << argv[0] << " <kernel> <global-size|auto> <local-size|auto> [--popcount-sort] [--static <file>] [--dynamic <file>] [--single-work-item] [--depth <chunks>] [--chunk <hashes>] [--static-tile <hashes>] [--results <count>] [--generic] [--retune] [--all-devices] [--host-threads <count>] [--trace <file>]" << std::endl;
+		return -1;
+	}
+
+	// Sort both sets by popcount and skip dynamic chunks that can not reach the threshold
+	bool popcountSort = false;
+	// Hex text or binary hash files, see HashFile.h
+	const char* pStaticFile = "a.txt";
+	const char* pDynFile = "b_1m.txt";
+	// Run the single work item kernel on CPU devices instead of hamming_dist_ndrange
+	bool singleWorkItem = false;
+	// Chunks in flight at the same time
+	size_t pipelineDepth = 4;
+	bool depthSet = false;
+	// Dynamic hashes per chunk, 0 = max(global size, SEQ_A_SIZE) for the NDRange kernel and SEQ_A_SIZE otherwise
+	size_t chunkSize = 0;
+	// Static hashes per local memory tile of hamming_dist_ndrange, 0 = as many as fit into CL_DEVICE_LOCAL_MEM_SIZE
+	size_t staticTile = 0;
+	// Results per output region, 0 = sized from the device memory
+	size_t resultCapacity = 0;
+	// Only use the kernel that takes every size at runtime
+	bool genericOnly = false;
+	// Sweep the work sizes again instead of loading the stored ones
+	bool retune = false;
+	// Split the dynamic set between every OpenCL device and worker threads of the host
+	bool allDevices = false;
+	size_t hostThreads = 0;
+	// Chrome trace of the host spans and device commands, see Trace.h
+	const char* pTraceFile = NULL;
+
+	for (int i = 4; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--popcount-sort") == 0)
+			popcountSort = true;
+		else if (strcmp(argv[i], "--static") == 0 && i + 1 < argc)
+			pStaticFile = argv[++i];
+		else if (strcmp(argv[i], "--dynamic") == 0 && i + 1 < argc)
+			pDynFile = argv[++i];
+		else if (strcmp(argv[i], "--single-work-item") == 0)
+			singleWorkItem = true;
+		else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+		{
+			pipelineDepth = atoi(argv[++i]);
+			depthSet = true;
+		}
+		else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc)
+			chunkSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--static-tile") == 0 && i + 1 < argc)
+			staticTile = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--results") == 0 && i + 1 < argc)
+			resultCapacity = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--generic") == 0)
+			genericOnly = true;
+		else if (strcmp(argv[i], "--retune") == 0)
+			retune = true;
+		else if (strcmp(argv[i], "--all-devices") == 0)
+			allDevices = true;
+		else if (strcmp(argv[i], "--host-threads") == 0 && i + 1 < argc)
+			hostThreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			pTraceFile = argv[++i];
+		else
+		{
+			std::cout << "Unknown option: " << argv[i] << std::endl;
+			return -1;
+		}
+	}
+
+	// With auto the work sizes, the chunk size and the pipeline depth come from the autotuner
+	const bool autoTune = strcmp(argv[2], "auto") == 0 && strcmp(argv[3], "auto") == 0;
+	size_t global = autoTune ? 1 : atoi(argv[2]);
+	size_t local = autoTune ? 1 : atoi(argv[3]);
+
+	if (global == 0 || local == 0 || global % local != 0)
+	{
+		std::cout << "The global size has to be a non zero multiple of the local size." << std::endl;
+		return -1;
+	}
+
+	if (pipelineDepth < 1)
+	{
+		std::cout << "The pipeline depth has to be at least 1." << std::endl;
+		return -1;
+	}
+
+	const char *pXclbinFilename = argv[1];
+	const bool coScheduled = allDevices || hostThreads > 0;
+
+	Trace trace(pTraceFile != NULL);
+	trace.nameProcess(0, "host");
+	trace.nameThread(0, 0, "main");
+
+	// Co-scheduled runs leave both unset
+	xcl_world world = {};
+	cl_kernel krnl = NULL;
+	cl_kernel krnlSpec = NULL;
+	bool ndrange = false;
+
+	// Precompiled binaries can not be specialized
+	if (strstr(argv[1], ".xclbin") != NULL)
+	{
+		if (coScheduled)
+		{
+			std::cout << "Co-scheduling builds the kernel for every device and needs the kernel source." << std::endl;
+			return -1;
+		}
+
+		genericOnly = true;
+//		world = xcl_world_single(CL_DEVICE_TYPE_ACCELERATOR, tarVendor, pTarDevName);
+		krnl = xcl_import_binary(world, pXclbinFilename, "hamming_dist");
+	}
+	else
+	{
+		ndrange = !singleWorkItem;
+
+		// Co-scheduled runs set up every device on their own, see coSchedule
+		if (!coScheduled)
+		{
+			world = xcl_world_single(CL_DEVICE_TYPE_CPU, NULL, NULL);
+			krnl = xcl_import_source(world, pXclbinFilename, ndrange ? "hamming_dist_ndrange" : "hamming_dist");
+		}
+	}
+
+	std::cout << "Kernel: " << (ndrange ? "hamming_dist_ndrange" : "hamming_dist") << std::endl;
+
+	// hamming_dist stages a whole chunk in a local array of SEQ_A_SIZE hashes
+	if (!ndrange && chunkSize > SEQ_A_SIZE)
+	{
+		std::cout << "The chunk size of hamming_dist can not exceed " << SEQ_A_SIZE << " hashes." << std::endl;
+		return -1;
+	}
+
+	// --------- LOAD INPUT DATA ---------
+	Timer execTimer;
+	execTimer.start();
+	double spanStart = trace.now();
+
+	std::vector<hash> staticStorage;
+	std::vector<hash> dynStorage;
+	HashFile staticFile;
+	HashFile dynFile;
+	HashView staticData;
+	HashView dynData;
+
+	if (!loadHashes(pStaticFile, staticFile, staticStorage, staticData) || !loadHashes(pDynFile, dynFile, dynStorage, dynData))
+		return -1;
+
+	// hamming_dist always reads SEQ_A_SIZE static hashes
+	if (!ndrange && staticData.size() < SEQ_A_SIZE)
+	{
+		std::cout << "The static data has to contain at least " << SEQ_A_SIZE << " hashes." << std::endl;
+		return -1;
+	}
+
+	if (staticData.size() > 0x8000000 || dynData.size() > 0x8000000)
+	{
+		std::cout << "Too many hashes, the indices do not fit into the 27 bit fields of a result." << std::endl;
+		return -1;
+	}
+
+	printf("---Static Data(%lu)---\nFirst: ", staticData.size());
+
+	for (int j = 0; j < 64; j++)
+		printf("%02x", staticData.front().bytes[j]);
+
+	printf("\nLast:  ");
+
+	for (int j = 0; j < 64; j++)
+		printf("%02x", staticData.back().bytes[j]);
+
+	printf("\n");
+
+	printf("---Dynamic Data(%lu)---\nFirst: ", dynData.size());
+
+	for (int j = 0; j < 64; j++)
+		printf("%02x", dynData.front().bytes[j]);
+
+	printf("\nLast:  ");
+
+	for (int j = 0; j < 64; j++)
+		printf("%02x", dynData.back().bytes[j]);
+
+	printf("\n");
+
+	execTimer.stop();
+	trace.hostSpan(0, 0, "load input", spanStart, trace.now());
+	printf("Input data load time: %0.3f ms\n", execTimer.getElapsedTimeInMilliSec());
+
+	// --------- LOAD INPUT DATA ---------
+
+	uint32_t threshold = 200;
+
+	std::vector<uint32_t> staticOrder;
+	std::vector<uint32_t> dynOrder;
+	std::vector<hash> staticSorted;
+	std::vector<hash> dynSorted;
+	const HashView staticInput = staticData;
+	const HashView dynInput = dynData;
+
+	// hamming_dist compares the first SEQ_A_SIZE static hashes, the NDRange
+	// kernel all of them, staged tile by tile in local memory
+	size_t staticCompared = ndrange ? staticData.size() : SEQ_A_SIZE;
+	size_t staticTileSize = SEQ_A_SIZE;
+
+	if (popcountSort)
+	{
+		execTimer.start();
+		spanStart = trace.now();
+		// Only the compared static hashes are sorted, hamming_dist has to
+		// see the same subset as without --popcount-sort
+		staticOrder = sortByPopcount(HashView(staticData.data(), std::min(staticCompared, staticData.size())), staticSorted);
+		dynOrder = sortByPopcount(dynData, dynSorted);
+		staticData = HashView(staticSorted.data(), staticSorted.size());
+		dynData = HashView(dynSorted.data(), dynSorted.size());
+		execTimer.stop();
+		trace.hostSpan(0, 0, "popcount sort", spanStart, trace.now());
+		printf("Popcount sort time: %0.3f ms\n", execTimer.getElapsedTimeInMilliSec());
+	}
+
+	if (coScheduled)
+	{
+		CoScheduleRun run;
+		run.pKernelFile = pXclbinFilename;
+		run.staticData = staticData;
+		run.dynData = dynData;
+		run.staticCompared = staticCompared;
+		run.threshold = threshold;
+		run.ndrange = ndrange;
+		run.popcountSort = popcountSort;
+		run.genericOnly = genericOnly;
+		run.autoTune = autoTune;
+		run.retune = retune;
+		run.global = global;
+		run.local = local;
+		run.chunkSize = chunkSize;
+		run.pipelineDepth = pipelineDepth;
+		run.depthSet = depthSet;
+		run.staticTile = staticTile;
+		run.resultCapacity = resultCapacity;
+		run.hostThreads = hostThreads;
+		run.hostChunk = chunkSize ? chunkSize : HOST_CHUNK_SIZE;
+		run.pTrace = &trace;
+
+		std::vector<xcl_world> worlds(allDevices ? MAX_DEVICES : 1);
+
+		if (allDevices)
+			worlds.resize(xcl_world_all(CL_DEVICE_TYPE_ALL, worlds.data(), (cl_uint) worlds.size()));
+		else
+			worlds[0] = xcl_world_single(CL_DEVICE_TYPE_CPU, NULL, NULL);
+
+		std::vector<uint64_t> results;
+
+		if (!coSchedule(run, worlds, results))
+			return -1;
+
+		if (popcountSort)
+			restoreInputOrder(results, staticOrder, dynOrder);
+
+		spanStart = trace.now();
+		verifyResults(results, staticInput, dynInput);
+		trace.hostSpan(0, 0, "verify", spanStart, trace.now());
+
+		if (pTraceFile && !writeTrace(trace, pTraceFile))
+			return -1;
+
+		fullTime.stop();
+
+		printf("Entire runtime: %0.3f ms\n", fullTime.getElapsedTimeInMilliSec());
+
+		return EXIT_SUCCESS;
+	}
+
+	if (ndrange)
+	{
+		cl_ulong localMemSize;
+		staticTileSize = staticTileSizeFor(world.device_id, staticTile, localMemSize);
+
+		if (staticTileSize == 0)
+		{
+			std::cout << "Not enough local memory for a static tile: " << localMemSize << " bytes." << std::endl;
+			return -1;
+		}
+
+		std::cout << "Static tile: " << staticTileSize << " hashes of " << localMemSize << " bytes local memory" << std::endl;
+	}
+
+	size_t num_static_tiles = (staticCompared + staticTileSize - 1) / staticTileSize;
+
+	// The sweep runs once per device and kernel source, later runs load its
+	// result from the tune file next to the kernel. Explicit --chunk and
+	// --depth options take precedence.
+	if (autoTune)
+	{
+		spanStart = trace.now();
+		WorkSizes sizes = workSizesFor(world, krnl, pXclbinFilename, ndrange, staticData, std::min(staticTileSize, staticCompared), dynData, retune);
+		trace.hostSpan(0, 0, "work sizes", spanStart, trace.now());
+
+		global = sizes.global;
+		local = sizes.local;
+
+		if (chunkSize == 0)
+			chunkSize = sizes.chunk;
+
+		if (!depthSet)
+			pipelineDepth = sizes.depth;
+
+		std::cout << "Work sizes: global " << global << " local " << local << " chunk " << chunkSize << " depth " << pipelineDepth << std::endl;
+	}
+
+	// We will break down our problem into multiple iterations. Each iteration
+	// will perform computation on a subset of the entire data-set. The
+	// NDRange kernel assigns one dynamic hash per work item, so the global
+	// size scales the chunk.
+	size_t elements_per_iteration = chunkSize ? chunkSize : ndrange ? std::max(global, (size_t) SEQ_A_SIZE) : SEQ_A_SIZE;
+	size_t num_chunks = (dynData.size() + elements_per_iteration - 1) / elements_per_iteration;
+
+	// Offsets of the dynamic chunks that are sent to the device, with sorted
+	// data a chunk is skipped when |pop(a) - pop(b)| >= threshold holds for
+	// all of its pairs, as |pop(a) - pop(b)| is a lower bound of the distance
+	std::vector<uint32_t> chunkOffsets;
+
+	uint32_t staticPopMin = popcountSort ? popCnt512(staticData.front()) : 0;
+	uint32_t staticPopMax = popcountSort ? popCnt512(staticData[staticCompared - 1]) : 512;
+
+	for (size_t c = 0; c < num_chunks; c++)
+	{
+		uint32_t offset = elements_per_iteration * c;
+
+		if (popcountSort)
+		{
+			size_t last = std::min(offset + elements_per_iteration, dynData.size()) - 1;
+			uint32_t dynPopMin = popCnt512(dynData[offset]);
+			uint32_t dynPopMax = popCnt512(dynData[last]);
+
+			if (dynPopMin >= staticPopMax + threshold || staticPopMin >= dynPopMax + threshold)
+				continue;
+		}
+
+		chunkOffsets.push_back(offset);
+	}
+
+	size_t num_iterations = chunkOffsets.size();
+
+	if (popcountSort)
+		std::cout << "Skipped chunks: " << num_chunks - num_iterations << " of " << num_chunks << std::endl;
+
+	std::cout << "Static tiles: " << num_static_tiles << std::endl;
+
+	// The kernels number the pairs of a tile launch with 32 bit
+	if ((uint64_t) elements_per_iteration * staticTileSize >= NO_RESUME)
+	{
+		std::cout << "Too many pairs per launch, please reduce the chunk or static tile size." << std::endl;
+		return -1;
+	}
+
+	if (resultCapacity == 0)
+		resultCapacity = resultCapacityFor(world.device_id, pipelineDepth, elements_per_iteration, staticCompared, staticTileSize);
+
+	// A resumed tile has to make progress with a single dynamic hash
+	if (resultCapacity < (ndrange ? staticTileSize : 1))
+	{
+		std::cout << "The result capacity has to be at least the static tile size: " << staticTileSize << " results." << std::endl;
+		return -1;
+	}
+
+	clReleaseCommandQueue(world.command_queue);
+	world.command_queue = clCreateCommandQueue(world.context, world.device_id, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_PROFILING_ENABLE, &err);
+
+	// Every chunk writes its hits to the output region and counter of its
+	// pipeline slot, so chunks do not depend on each other and up to
+	// pipelineDepth of them are in flight. The slots are drained in chunk
+	// order, which places every region at the prefix sum of the counts of
+	// the chunks before it.
+	std::vector<uint64_t> deviceResult;
+	std::vector<ChunkSlot> slots(pipelineDepth);
+	size_t overflowChunks = 0;
+	size_t resumes = 0;
+
+	// Counter and resume positions before a launch
+	std::vector<uint32_t> stateInit(1 + num_static_tiles, NO_RESUME);
+	stateInit[0] = 0;
+
+	cl_mem staticDataBuffer = clCreateBuffer(world.context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, staticCompared * sizeof(hash), (void*) staticData.data(), NULL);
+
+	// The migration aligns the device clock with the host clock of the trace
+	spanStart = trace.now();
+	cl_event staticEvent;
+	OCL_CHECK(clEnqueueMigrateMemObjects(world.command_queue, 1, &staticDataBuffer, 0 /* flags, 0 means from host */, 0, NULL, &staticEvent));
+
+	trace.calibrate(1, staticEvent, spanStart);
+	trace.command(1, 0, staticEvent, "migrate static", "transfer", "");
+
+	// Full chunks and static tiles run a program built for their sizes, every
+	// configuration is built once and then loaded from the binary cache
+	const size_t specSeqBLength = std::min(elements_per_iteration, dynData.size());
+	const size_t specSeqALength = std::min(staticTileSize, staticCompared);
+
+	if (!genericOnly)
+	{
+		const std::string options = specializationOptions(ndrange, threshold, specSeqBLength, specSeqALength, (uint32_t) resultCapacity);
+		std::cout << "Specialized kernel: " << options << std::endl;
+		krnlSpec = xcl_import_source(world, pXclbinFilename, ndrange ? "hamming_dist_ndrange" : "hamming_dist", options.c_str());
+	}
+
+	clWaitForEvents(1, &staticEvent);
+	OCL_CHECK(clReleaseEvent(staticEvent));
+
+	// The ring replaces a buffer create, migration and release per chunk. It
+	// is timed on its own, the migration commits the device memory the
+	// buffers would otherwise allocate with their first write.
+	Timer ringTimer;
+	ringTimer.start();
+
+	createSlots(world.context, slots, elements_per_iteration, resultCapacity, stateInit.size());
+
+	std::vector<cl_mem> ringBuffers;
+
+	for (ChunkSlot& slot : slots)
+		ringBuffers.push_back(slot.dynBuffer);
+
+	cl_event ringEvent;
+	OCL_CHECK(clEnqueueMigrateMemObjects(world.command_queue, (cl_uint) ringBuffers.size(), ringBuffers.data(), CL_MIGRATE_MEM_OBJECT_CONTENT_UNDEFINED, 0, NULL, &ringEvent));
+	clWaitForEvents(1, &ringEvent);
+	OCL_CHECK(clReleaseEvent(ringEvent));
+
+	ringTimer.stop();
+
+	LaunchConfig cfg;
+	cfg.queue = world.command_queue;
+	cfg.krnl = krnl;
+	cfg.krnlSpec = krnlSpec;
+	cfg.specSeqBLength = (uint32_t) specSeqBLength;
+	cfg.specSeqALength = (uint32_t) specSeqALength;
+	cfg.specLaunches = 0;
+	cfg.genericLaunches = 0;
+	cfg.ndrange = ndrange;
+	cfg.global = global;
+	cfg.local = local;
+	cfg.capacity = (uint32_t) resultCapacity;
+	cfg.pStateInit = stateInit.data();
+	cfg.pTrace = &trace;
+	cfg.tracePid = 1;
+
+	if (trace.enabled())
+	{
+		char deviceName[256] = "";
+		clGetDeviceInfo(world.device_id, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
+		traceSlots(cfg, deviceName, pipelineDepth);
+	}
+
+	cl_ulong write_time = 0;
+	cl_ulong kernelExecTime = 0;
+
+	setStaticArgs(cfg, staticDataBuffer, threshold, staticTileSize);
+
+	size_t skippedTiles = 0;
+
+	std::cout << "Iterations: " << num_iterations << std::endl;
+	std::cout << "Input buffer ring: " << pipelineDepth << " x " << elements_per_iteration << " hashes" << std::endl;
+	std::cout << "Output regions: " << pipelineDepth << " x 2 x " << resultCapacity << " results" << std::endl;
+
+	execTimer.start();
+	spanStart = trace.now();
+
+	for (size_t iteration_idx = 0; iteration_idx < num_iterations; iteration_idx++)
+	{
+		ChunkSlot& slot = slots[iteration_idx % pipelineDepth];
+		uint32_t seqBOffset = chunkOffsets[iteration_idx];
+
+		uint32_t seqBPartLength = (uint32_t) std::min(dynData.size() - seqBOffset, elements_per_iteration);
+
+		// Reuse the slot of the chunk pipelineDepth iterations ago
+		if (iteration_idx >= pipelineDepth)
+		{
+			size_t slotResumes = drainSlot(cfg, slot, deviceResult, kernelExecTime, write_time);
+			overflowChunks += slotResumes > 0;
+			resumes += slotResumes;
+		}
+
+		slot.seqBOffset = seqBOffset;
+		slot.seqBLength = seqBPartLength;
+		slot.outputIdx = 0;
+		slot.chunk = iteration_idx;
+
+		skippedTiles += planTiles(slot, staticData, staticCompared, staticTileSize, dynData, popcountSort, threshold);
+		enqueueChunk(cfg, slot, &dynData[seqBOffset]);
+	}
+
+	// Wait for all of the OpenCL operations to complete
+	printf("Waiting...\n");
+	clFlush(world.command_queue);
+
+	for (size_t i = num_iterations > pipelineDepth ? num_iterations - pipelineDepth : 0; i < num_iterations; i++)
+	{
+		size_t slotResumes = drainSlot(cfg, slots[i % pipelineDepth], deviceResult, kernelExecTime, write_time);
+		overflowChunks += slotResumes > 0;
+		resumes += slotResumes;
+	}
+
+	clFinish(world.command_queue);
+
+	uint32_t resCnt = (uint32_t) deviceResult.size();
+
+	if (overflowChunks > 0)
+		std::cout << "Result overflow in " << overflowChunks << " chunks, resumed " << resumes << " times." << std::endl;
+
+	if (popcountSort)
+		std::cout << "Skipped static tile launches: " << skippedTiles << " of " << num_iterations * num_static_tiles << std::endl;
+
+	std::cout << "Launches: " << cfg.specLaunches << " specialized, " << cfg.genericLaunches << " generic" << std::endl;
+	std::cout << "Final Count: " << resCnt << std::endl;
+
+	execTimer.stop();
+	trace.hostSpan(0, 0, "stream chunks", spanStart, trace.now());
+	trace.resolve();
+
+	releaseSlots(slots);
+
+	OCL_CHECK(clReleaseMemObject(staticDataBuffer));
+
+	xcl_release_kernel(krnl);
+
+	if (krnlSpec)
+		xcl_release_kernel(krnlSpec);
+	xcl_release_world(world);
+
+
+	if (popcountSort)
+	{
+		restoreInputOrder(deviceResult, staticOrder, dynOrder);
+
+		staticData = staticInput;
+		dynData = dynInput;
+	}
+
+#ifdef PERFORMACE
+	printf("Entire OpenCL execution time: %0.3f ms\n", execTimer.getElapsedTimeInMilliSec());
+
+	cl_double kernelExecTimeMS = (cl_double)(kernelExecTime)*(cl_double)(1e-06);
+
+	printf("Execution time for %llu elements in milliseconds = %0.3f ms\n", (unsigned long long) (staticCompared * dynData.size()), kernelExecTimeMS);
+	printf("Hashes per second: %s\n", hps((staticCompared * dynData.size()) / (kernelExecTimeMS / 1000.0)).c_str());
+
+	printf("Write time in milliseconds = %0.3f ms\n", (cl_double)(write_time)*(cl_double)(1e-06));
+	printf("Input buffer ring setup time in milliseconds = %0.3f ms (%llu buffers for %llu chunks)\n", ringTimer.getElapsedTimeInMilliSec(), (unsigned long long) slots.size(), (unsigned long long) num_iterations);
+
+#endif
+
+	spanStart = trace.now();
+	verifyResults(deviceResult, staticData, dynData);
+	trace.hostSpan(0, 0, "verify", spanStart, trace.now());
+
+	if (pTraceFile && !writeTrace(trace, pTraceFile))
+		return -1;
 
 	fullTime.stop();
 
@@ -30,7 +30,14 @@ THE SOFTWARE.
 /* When this value is changed the kernel needs to be recompiled
  * unless the kernel was changed it will not be recompiled
  * */
-#define SEQ_A_SIZE 100 // Static sequence
+#define SEQ_A_SIZE 100 // Static sequence of hamming_dist, hamming_dist_ndrange takes the static size at runtime
 
 #define SEQ_A_BYTE_SIZE SEQ_A_SIZE * 64
-#define MAX_OUTPUT_DATA_SIZE 1000
\ No newline at end of file
+#define MAX_OUTPUT_DATA_SIZE (1 << 22) // Upper bound of the results per output region, the host sizes the regions from the device memory
+
+// Hits buffered in local memory per work group by hamming_dist_ndrange
+#define LOCAL_HITS_SIZE 256
+
+// Co-scheduled runs, see coSchedule in hamming.cpp
+#define MAX_DEVICES 16
+#define HOST_CHUNK_SIZE 1024 // Dynamic hashes per range of a host worker thread
\ No newline at end of file
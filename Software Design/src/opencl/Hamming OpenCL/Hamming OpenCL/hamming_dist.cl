@@ -33,9 +33,46 @@ uint accumulate_uint16(uint16 val)
 	return val.s0 + val.s1;
 }
 
+/* Specialized programs are built with some of the SPEC_ options, which
+ * turn the matching kernel arguments into compile time constants. The
+ * generic program takes all of them at runtime.
+ * */
+#ifdef SPEC_THRESHOLD
+#define THRESHOLD(arg) SPEC_THRESHOLD
+#else
+#define THRESHOLD(arg) (arg)
+#endif
+
+#ifdef SPEC_SEQ_B_LENGTH
+#define SEQ_B_LENGTH(arg) SPEC_SEQ_B_LENGTH
+#else
+#define SEQ_B_LENGTH(arg) (arg)
+#endif
+
+#ifdef SPEC_SEQ_A_LENGTH
+#define SEQ_A_LENGTH(arg) SPEC_SEQ_A_LENGTH
+#else
+#define SEQ_A_LENGTH(arg) (arg)
+#endif
+
+#ifdef SPEC_RES_CAPACITY
+#define RES_CAPACITY(arg) SPEC_RES_CAPACITY
+#else
+#define RES_CAPACITY(arg) (arg)
+#endif
+
+/* The pairs are numbered i * seqBLength + j, the kernel starts at pair
+ * resumeFrom and stores at most resCapacity results. When the output buffer
+ * is full the first pair that was not stored goes to pResCnt[1], so the
+ * host can resume from there.
+ * */
 __kernel //__attribute__ ((reqd_work_group_size(256, 1, 1)))
-void hamming_dist(__global ulong* pC, __global uint16* pA, __global uint16* pB, uint seqBLength, uint seqBOffset, uint threshold, __global uint* pResCnt)
+void hamming_dist(__global ulong* pC, __global uint16* pA, __global uint16* pB, uint seqBLength, uint seqBOffset, uint threshold, __global uint* pResCnt, uint resCapacity, uint resumeFrom)
 {
+	seqBLength = SEQ_B_LENGTH(seqBLength);
+	threshold = THRESHOLD(threshold);
+	resCapacity = RES_CAPACITY(resCapacity);
+
 	local uint16 staticData[SEQ_A_SIZE];
 	local uint16 dynamicData[SEQ_A_SIZE];
 	local ulong result;
@@ -43,37 +80,146 @@ void hamming_dist(__global ulong* pC, __global uint16* pA, __global uint16* pB,
 
 	resCnt[0] = *pResCnt;
 
-	if(resCnt[0] >= MAX_OUTPUT_DATA_SIZE)
+	if(resCnt[0] >= resCapacity)
 	{
+		pResCnt[1] = resumeFrom;
 		return; // Exit here incase the output buffer is full
 	}
 
 	async_work_group_copy(staticData, pA, SEQ_A_SIZE, 0);
 	async_work_group_copy(dynamicData, pB, seqBLength, 0);
 
+	const ulong firstI = resumeFrom / seqBLength;
+
 // Loop over the static data of sequence A
-	for (ulong i = 0; i < SEQ_A_SIZE; i++)
+	for (ulong i = firstI; i < SEQ_A_SIZE; i++)
 	{
 		// Loop over the dynamic data of sequence B
-		for (ulong j = 0; j < seqBLength; j++)
+		for (ulong j = i == firstI ? resumeFrom % seqBLength : 0; j < seqBLength; j++)
 		{
 			result = accumulate_uint16(popcount(staticData[i] ^ dynamicData[j])); // Hamming distance
 			if (result < threshold)
 			{
+				if(resCnt[0] >= resCapacity)
+				{
+					pResCnt[1] = i * seqBLength + j;
+					async_work_group_copy(pResCnt, &resCnt[0], 1, 0);
+					return; // Exit here incase the output buffer is full
+				}
+
 				result |= (j + seqBOffset) << 10; // Index B
 				result |= i << 37; // Index A
 
 				pC[resCnt[0]] = result;
 				resCnt[0]++;
+			}
+		}
+	}
+
+	async_work_group_copy(pResCnt, &resCnt[0], 1, 0);
+}
+
+/* Data-parallel variant for CPU and GPU runtimes. Every work group stages
+ * the static tile [seqAOffset, seqAOffset + seqALength) of pA in local
+ * memory (staticData is sized by the host), every work item owns one
+ * dynamic hash at a time (grid-stride over the chunk) and compares it
+ * against the staged tile. Hits are collected per work group and copied
+ * to pC with a single global atomic, hits that do not fit into the local
+ * buffer go to pC directly.
+ *
+ * The pairs of the tile are numbered j * seqALength + i, the kernel starts
+ * at pair resumeFrom and stores at most resCapacity results. Every hit that
+ * does not fit lowers pResCnt[1 + resumeIdx] to its pair, all hits before
+ * that pair are stored and the host resumes from there.
+ * */
+__kernel
+void hamming_dist_ndrange(__global ulong* pC, __global uint16* pA, __global uint16* pB, uint seqBLength, uint seqBOffset, uint threshold, __global uint* pResCnt, uint seqALength, uint seqAOffset, __local uint16* staticData, uint resCapacity, uint resumeFrom, uint resumeIdx)
+{
+	seqBLength = SEQ_B_LENGTH(seqBLength);
+	threshold = THRESHOLD(threshold);
+	seqALength = SEQ_A_LENGTH(seqALength);
+	resCapacity = RES_CAPACITY(resCapacity);
+
+	local ulong hits[LOCAL_HITS_SIZE];
+	local uint hitCnt;
+	local uint hitBase;
+
+	const uint lid = get_local_id(0);
+	const uint lsize = get_local_size(0);
+
+	if (lid == 0)
+	{
+		hitCnt = 0;
+		hitBase = *pResCnt;
+	}
+
+	event_t e = async_work_group_copy(staticData, pA + seqAOffset, seqALength, 0);
+	wait_group_events(1, &e);
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	__global uint* pResume = &pResCnt[1 + resumeIdx];
+	const uint firstJ = resumeFrom / seqALength;
 
-				if(resCnt[0] >= MAX_OUTPUT_DATA_SIZE)
+	if (hitBase >= resCapacity)
+	{
+		// Exit here incase the output buffer is full, the whole group reads the same value
+		const uint j = firstJ + get_global_id(0);
+
+		if (j < seqBLength)
+			atomic_min(pResume, j == firstJ ? resumeFrom : j * seqALength);
+
+		return;
+	}
+
+	for (uint j = firstJ + get_global_id(0); j < seqBLength; j += get_global_size(0))
+	{
+		const uint16 b = pB[j];
+
+		for (uint i = j == firstJ ? resumeFrom % seqALength : 0; i < seqALength; i++)
+		{
+			ulong result = accumulate_uint16(popcount(staticData[i] ^ b)); // Hamming distance
+
+			if (result < threshold)
+			{
+				result |= (ulong) (j + seqBOffset) << 10; // Index B
+				result |= (ulong) (i + seqAOffset) << 37; // Index A
+
+				const uint slot = atomic_inc(&hitCnt);
+
+				if (slot < LOCAL_HITS_SIZE)
+					hits[slot] = result;
+				else
 				{
-					async_work_group_copy(pResCnt, &resCnt[0], 1, 0);
-					return; // Exit here incase the output buffer is full
+					const uint idx = atomic_inc(pResCnt);
+
+					if (idx < resCapacity)
+						pC[idx] = result;
+					else
+						atomic_min(pResume, j * seqALength + i);
 				}
 			}
 		}
 	}
 
-	async_work_group_copy(pResCnt, &resCnt[0], 1, 0);
+	// Per work group compaction
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	const uint cnt = min(hitCnt, (uint) LOCAL_HITS_SIZE);
+
+	if (lid == 0)
+		hitBase = cnt ? atomic_add(pResCnt, cnt) : 0;
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (uint k = lid; k < cnt; k += lsize)
+	{
+		if (hitBase + k < resCapacity)
+			pC[hitBase + k] = hits[k];
+		else
+		{
+			const uint j = ((hits[k] >> 10) & 0x7FFFFFF) - seqBOffset;
+			const uint i = (hits[k] >> 37) - seqAOffset;
+			atomic_min(pResume, j * seqALength + i);
+		}
+	}
 }
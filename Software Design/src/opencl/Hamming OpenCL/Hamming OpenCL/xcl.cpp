@@ -94,6 +94,231 @@ static int load_file_to_memory(const char *filename, char **result)
 	return size;
 }
 
+/* Reads a whole file without failing, returns 0 if it can not be read */
+static int try_load_file(const char *filename, char **result, size_t *size)
+{
+	FILE *f = fopen(filename, "rb");
+	if (f == NULL)
+		return 0;
+
+	fseek(f, 0, SEEK_END);
+	long len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if (len < 0)
+	{
+		fclose(f);
+		return 0;
+	}
+
+	*size = (size_t) len;
+	*result = (char *) smalloc(*size + 1);
+
+	if (*size != fread(*result, sizeof(char), *size, f))
+	{
+		free(*result);
+		fclose(f);
+		return 0;
+	}
+
+	fclose(f);
+	(*result)[*size] = 0;
+
+	return 1;
+}
+
+/* 64 bit FNV-1a */
+static unsigned long long hash_bytes(unsigned long long h, const void *data, size_t size)
+{
+	const unsigned char *p = (const unsigned char *) data;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
+
+	return h;
+}
+
+static unsigned long long hash_device_info(unsigned long long h, cl_device_id device, cl_device_info param)
+{
+	char info[1024] = { 0 };
+	clGetDeviceInfo(device, param, sizeof(info) - 1, info, NULL);
+
+	return hash_bytes(h, info, strlen(info) + 1);
+}
+
+/* Key of a program in the binary cache, covers the source, the headers it
+ * includes from the directory of the kernel file, the build options and
+ * the device and driver it is built for
+ * */
+static unsigned long long program_key(xcl_world world, const char *krnl_file, const char *source, const char *options)
+{
+	unsigned long long key = 0xcbf29ce484222325ULL;
+	key = hash_bytes(key, source, strlen(source) + 1);
+
+	const char *dir_end = krnl_file;
+	for (const char *c = krnl_file; *c; c++)
+	{
+		if (*c == '/' || *c == '\\')
+			dir_end = c + 1;
+	}
+
+	const char *inc = source;
+	while ((inc = strstr(inc, "#include \"")) != NULL)
+	{
+		inc += strlen("#include \"");
+		const char *inc_end = strchr(inc, '"');
+		if (inc_end == NULL)
+			break;
+
+		char path[1024];
+		char *header;
+		size_t header_size;
+		snprintf(path, sizeof(path), "%.*s%.*s", (int) (dir_end - krnl_file), krnl_file, (int) (inc_end - inc), inc);
+
+		if (try_load_file(path, &header, &header_size))
+		{
+			key = hash_bytes(key, header, header_size);
+			free(header);
+		}
+		else
+			key = hash_bytes(key, path, strlen(path));
+
+		inc = inc_end;
+	}
+
+	key = hash_bytes(key, options ? options : "", options ? strlen(options) + 1 : 1);
+	key = hash_device_info(key, world.device_id, CL_DEVICE_NAME);
+	key = hash_device_info(key, world.device_id, CL_DEVICE_VENDOR);
+	key = hash_device_info(key, world.device_id, CL_DEVICE_VERSION);
+	key = hash_device_info(key, world.device_id, CL_DRIVER_VERSION);
+
+	return key;
+}
+
+/* Header of a cached program binary, the binary follows right after it */
+typedef struct
+{
+		char magic[8];
+		unsigned long long key;
+		unsigned long long size;
+} xcl_cache_header;
+
+static const char xcl_cache_magic[8] = { 'C', 'L', 'P', 'R', 'O', 'G', '0', '1' };
+
+/* The cache lives next to the kernel file or in $XCL_CACHE_DIR, it is
+ * disabled by setting $XCL_NO_CACHE
+ * */
+static int cache_path(char *path, size_t size, const char *krnl_file, unsigned long long key)
+{
+	if (getenv("XCL_NO_CACHE") != NULL)
+		return 0;
+
+	const char *dir = getenv("XCL_CACHE_DIR");
+
+	if (dir == NULL)
+	{
+		snprintf(path, size, "%s.%016llx.bin", krnl_file, key);
+		return 1;
+	}
+
+	const char *base = krnl_file;
+	for (const char *c = krnl_file; *c; c++)
+	{
+		if (*c == '/' || *c == '\\')
+			base = c + 1;
+	}
+
+	snprintf(path, size, "%s/%s.%016llx.bin", dir, base, key);
+	return 1;
+}
+
+/* Creates and builds the program from a cached binary, returns NULL if
+ * there is none or it does not match
+ * */
+static cl_program load_cached_program(xcl_world world, const char *path, unsigned long long key, const char *options)
+{
+	char *data;
+	size_t size;
+
+	if (!try_load_file(path, &data, &size))
+		return NULL;
+
+	xcl_cache_header header;
+	cl_program program = NULL;
+
+	if (size > sizeof(header))
+	{
+		memcpy(&header, data, sizeof(header));
+
+		if (memcmp(header.magic, xcl_cache_magic, sizeof(xcl_cache_magic)) == 0 && header.key == key && header.size == size - sizeof(header))
+		{
+			const size_t bin_size = (size_t) header.size;
+			const unsigned char *bin = (const unsigned char *) data + sizeof(header);
+			cl_int status = CL_SUCCESS;
+			cl_int err = CL_SUCCESS;
+
+			program = clCreateProgramWithBinary(world.context, 1, &world.device_id, &bin_size, &bin, &status, &err);
+
+			if (program && (err != CL_SUCCESS || status != CL_SUCCESS || clBuildProgram(program, 0, NULL, options, NULL, NULL) != CL_SUCCESS))
+			{
+				clReleaseProgram(program);
+				program = NULL;
+			}
+		}
+	}
+
+	free(data);
+
+	if (program == NULL)
+		printf("INFO: Ignoring stale program binary %s\n", path);
+
+	return program;
+}
+
+/* Stores the binary of a built program, a failure only costs the next
+ * start a rebuild
+ * */
+static void store_cached_program(cl_program program, const char *path, unsigned long long key)
+{
+	size_t bin_size = 0;
+
+	if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &bin_size, NULL) != CL_SUCCESS || bin_size == 0)
+		return;
+
+	xcl_cache_header header;
+	memcpy(header.magic, xcl_cache_magic, sizeof(xcl_cache_magic));
+	header.key = key;
+	header.size = bin_size;
+
+	unsigned char *bin = (unsigned char *) smalloc(bin_size);
+
+	if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char *), &bin, NULL) == CL_SUCCESS)
+	{
+		// Write to a temporary file first, so other processes never see a partial binary
+		char tmp_path[1100];
+		snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+		FILE *f = fopen(tmp_path, "wb");
+		if (f != NULL)
+		{
+			int ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(bin, 1, bin_size, f) == bin_size;
+			ok = fclose(f) == 0 && ok;
+
+			remove(path);
+
+			if (ok && rename(tmp_path, path) == 0)
+				printf("INFO: Cached program binary %s\n", path);
+			else
+				remove(tmp_path);
+		}
+	}
+
+	free(bin);
+}
+
 xcl_world xcl_world_single(cl_device_type device_type, const char *target_vendor, const char *target_device)
 {
 	int err;
@@ -231,6 +456,75 @@ xcl_world xcl_world_single(cl_device_type device_type, const char *target_vendor
 	return world;
 }
 
+cl_uint xcl_world_all(cl_device_type device_type, xcl_world *worlds, cl_uint max_worlds)
+{
+	int err;
+	cl_uint num_platforms;
+	cl_uint num_worlds = 0;
+
+	err = clGetPlatformIDs(0, NULL, &num_platforms);
+	if (err != CL_SUCCESS)
+	{
+		printf("Error: no platforms available or OpenCL install broken");
+		printf("Test failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	cl_platform_id *platform_ids = (cl_platform_id *) malloc(sizeof(cl_platform_id) * num_platforms);
+
+	if (platform_ids == NULL)
+	{
+		printf("Error: Out of Memory\n");
+		printf("Test failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	err = clGetPlatformIDs(num_platforms, platform_ids, NULL);
+	if (err != CL_SUCCESS)
+	{
+		printf("Error: Failed to find an OpenCL platform!\n");
+		printf("Test failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (cl_uint i = 0; i < num_platforms && num_worlds < max_worlds; i++)
+	{
+		cl_device_id devices[16];
+		cl_uint num_devices = 0;
+
+		// Platforms without a device of this type are skipped
+		if (clGetDeviceIDs(platform_ids[i], device_type, 16, devices, &num_devices) != CL_SUCCESS)
+			continue;
+
+		for (cl_uint d = 0; d < num_devices && d < 16 && num_worlds < max_worlds; d++)
+		{
+			xcl_world& world = worlds[num_worlds++];
+			world.platform_id = platform_ids[i];
+			world.device_id = devices[d];
+
+			world.context = clCreateContext(0, 1, &world.device_id, NULL, NULL, &err);
+			if (err != CL_SUCCESS)
+			{
+				printf("Error: Failed to create a compute context!\n");
+				printf("Test failed\n");
+				exit(EXIT_FAILURE);
+			}
+
+			world.command_queue = clCreateCommandQueue(world.context, world.device_id, CL_QUEUE_PROFILING_ENABLE, &err);
+			if (err != CL_SUCCESS)
+			{
+				printf("Error: Failed to create a command queue!\n");
+				printf("Test failed\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	free(platform_ids);
+
+	return num_worlds;
+}
+
 void xcl_release_world(xcl_world world)
 {
 	clReleaseCommandQueue(world.command_queue);
@@ -275,39 +569,52 @@ cl_kernel xcl_import_binary(xcl_world world, const char *krnl_file, const char *
 	}
 
 	/* if program is released, then EnqueueNDRangeKernel fails with
-	 * INVALID_KERNEL */
-	/* clReleaseProgram(program); */
+	 * INVALID_KERNEL, it is released with the kernel by xcl_release_kernel */
 	free(krnl_bin);
 
 	return kernel;
 }
 
-cl_kernel xcl_import_source(xcl_world world, const char *krnl_file, const char *krnl_name)
+cl_kernel xcl_import_source(xcl_world world, const char *krnl_file, const char *krnl_name, const char *options)
 {
 	int err;
 
 	char *krnl_bin;
 	load_file_to_memory(krnl_file, &krnl_bin);
 
-	cl_program program = clCreateProgramWithSource(world.context, 1, (const char**) &krnl_bin, 0, &err);
-	if ((err != CL_SUCCESS) || (!program))
-	{
-		printf("Error: Failed to create compute program from binary %d!\n", err);
-		printf("Test failed\n");
-		exit(EXIT_FAILURE);
-	}
+	char cache_file[1024];
+	const unsigned long long key = program_key(world, krnl_file, krnl_bin, options);
+	const int cached = cache_path(cache_file, sizeof(cache_file), krnl_file, key);
 
-	err = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
-	if (err != CL_SUCCESS)
+	cl_program program = cached ? load_cached_program(world, cache_file, key, options) : NULL;
+
+	if (program)
+		printf("INFO: Loaded program binary %s\n", cache_file);
+	else
 	{
-		size_t len;
-		char buffer[2048];
+		program = clCreateProgramWithSource(world.context, 1, (const char**) &krnl_bin, 0, &err);
+		if ((err != CL_SUCCESS) || (!program))
+		{
+			printf("Error: Failed to create compute program from binary %d!\n", err);
+			printf("Test failed\n");
+			exit(EXIT_FAILURE);
+		}
 
-		printf("Error: Failed to build program executable!\n");
-		clGetProgramBuildInfo(program, world.device_id, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
-		printf("%s\n", buffer);
-		printf("Test failed\n");
-		exit(EXIT_FAILURE);
+		err = clBuildProgram(program, 0, NULL, options, NULL, NULL);
+		if (err != CL_SUCCESS)
+		{
+			size_t len;
+			char buffer[2048];
+
+			printf("Error: Failed to build program executable!\n");
+			clGetProgramBuildInfo(program, world.device_id, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
+			printf("%s\n", buffer);
+			printf("Test failed\n");
+			exit(EXIT_FAILURE);
+		}
+
+		if (cached)
+			store_cached_program(program, cache_file, key);
 	}
 
 	cl_kernel kernel = clCreateKernel(program, krnl_name, &err);
@@ -319,13 +626,36 @@ cl_kernel xcl_import_source(xcl_world world, const char *krnl_file, const char *
 	}
 
 	/* if program is released, then EnqueueNDRangeKernel fails with
-	 * INVALID_KERNEL */
-	/* clReleaseProgram(program); */
+	 * INVALID_KERNEL, it is released with the kernel by xcl_release_kernel */
 	free(krnl_bin);
 
 	return kernel;
 }
 
+unsigned long long xcl_source_key(xcl_world world, const char *krnl_file, const char *options)
+{
+	char *krnl_bin;
+	load_file_to_memory(krnl_file, &krnl_bin);
+
+	const unsigned long long key = program_key(world, krnl_file, krnl_bin, options);
+	free(krnl_bin);
+
+	return key;
+}
+
+void xcl_release_kernel(cl_kernel krnl)
+{
+	cl_program program = NULL;
+
+	if (clGetKernelInfo(krnl, CL_KERNEL_PROGRAM, sizeof(cl_program), &program, NULL) != CL_SUCCESS)
+		program = NULL;
+
+	clReleaseKernel(krnl);
+
+	if (program)
+		clReleaseProgram(program);
+}
+
 void xcl_set_kernel_arg(cl_kernel krnl, cl_uint num, size_t size, const void *ptr)
 {
 	int err = clSetKernelArg(krnl, num, size, ptr);
@@ -65,6 +65,22 @@ typedef struct
  */
 xcl_world xcl_world_single(cl_device_type device_type, const char *target_vendor, const char *target_device);
 
+/* xcl_world_all
+ *
+ * Description:
+ *   Setup an xcl_world for every device of the given type on all
+ *   platforms.
+ *
+ * Inputs:
+ *   device_type - the type of devices (i.e. CL_DEVICE_TYPE_ALL)
+ *   worlds      - array that receives the worlds.
+ *   max_worlds  - size of worlds.
+ *
+ * Returns:
+ *   The number of worlds set up.
+ */
+cl_uint xcl_world_all(cl_device_type device_type, xcl_world *worlds, cl_uint max_worlds);
+
 /* xcl_release_world
  *
  * Description:
@@ -94,17 +110,46 @@ cl_kernel xcl_import_binary(xcl_world world, const char *krnl_file, const char *
 /* xcl_import_source
  *
  * Description:
- *   Import opencl source code.
+ *   Import opencl source code. The built program binary is cached in
+ *   <krnl_file>.<key>.bin (or in $XCL_CACHE_DIR), keyed on the source, its
+ *   included headers, the build options, the device and the driver version,
+ *   and is loaded instead of building the source on the next import. Set
+ *   $XCL_NO_CACHE to always build from source.
  *
  * Inputs:
  *   world - xcl_world to import into.
  *   krnl_file - file name of the kernel to import.
  *   krnl_name - name of kernel.
+ *   options - build options passed to clBuildProgram, may be NULL.
  *
  * Returns:
  *   An opencl kernel object that was created from krnl_name file.
  */
-cl_kernel xcl_import_source(xcl_world world, const char *krnl_file, const char *krnl_name);
+cl_kernel xcl_import_source(xcl_world world, const char *krnl_file, const char *krnl_name, const char *options = NULL);
+
+/* xcl_source_key
+ *
+ * Description:
+ *   Key of a kernel source built for the device of world, as used by the
+ *   program binary cache of xcl_import_source.
+ *
+ * Inputs:
+ *   world - xcl_world of the device.
+ *   krnl_file - file name of the kernel source.
+ *   options - build options, may be NULL.
+ */
+unsigned long long xcl_source_key(xcl_world world, const char *krnl_file, const char *options = NULL);
+
+/* xcl_release_kernel
+ *
+ * Description:
+ *   Release a kernel returned by xcl_import_binary or xcl_import_source
+ *   together with its program.
+ *
+ * Inputs:
+ *   krnl - kernel to release.
+ */
+void xcl_release_kernel(cl_kernel krnl);
 
 /* xcl_set_kernel_arg
  *